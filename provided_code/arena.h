@@ -0,0 +1,63 @@
+/*
+ * Bump allocator that owns the AST nodes of one Parser. Nodes are freed all
+ * at once when the arena is destroyed, so many programs can be parsed in one
+ * process without leaking their trees.
+ */
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Arena {
+  public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (size_t i = destructors.size(); i > 0; --i) {
+            destructors[i - 1].second(destructors[i - 1].first);
+        }
+        for (char* block : blocks) {
+            delete[] block;
+        }
+    }
+
+    template <typename T>
+    T* make() {
+        T* obj = new (allocate(sizeof(T), alignof(T))) T();
+        if (!std::is_trivially_destructible<T>::value) {
+            destructors.push_back({obj, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return obj;
+    }
+
+  private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<char*> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    std::vector<std::pair<void*, void (*)(void*)>> destructors;
+
+    void* allocate(size_t size, size_t align) {
+        size_t pad = (align - (reinterpret_cast<size_t>(cursor) & (align - 1))) & (align - 1);
+        if (cursor == nullptr || cursor + pad + size > limit) {
+            // AST nodes are small; BLOCK_SIZE always fits one
+            char* block = new char[BLOCK_SIZE];
+            blocks.push_back(block);
+            cursor = block;
+            limit = block + BLOCK_SIZE;
+            pad = (align - (reinterpret_cast<size_t>(cursor) & (align - 1))) & (align - 1);
+        }
+        void* p = cursor + pad;
+        cursor += pad + size;
+        return p;
+    }
+};
+
+#endif  //__ARENA_H__
@@ -0,0 +1,449 @@
+/*
+ * Benchmark suite for the lexer, parser, semantic checks, Warning Code 2,
+ * degree computation and execution. See run_bench.sh for how it is built.
+ *
+ *   bench [generator options] [--iterations N] [--json FILE]
+ *         [--baseline FILE] [--tolerance FRACTION]
+ *   bench [generator options] --generate > program.txt
+ *
+ * Results are printed as JSON. The calibration phase is fixed work that does
+ * not use the code under test. With --baseline, each phase is compared in
+ * proportion to calibration, e.g. parse / calibration in this run against
+ * the same ratio in the baseline, so a machine that is faster or slower
+ * overall does not fail the check or hide a regression. Every phase whose
+ * ratio grew by more than the tolerance, or that the baseline does not
+ * have, is reported and the exit status is 1.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "../parser.h"
+#include "../polyarith.h"
+#include "program_gen.h"
+
+using namespace std;
+
+namespace {
+
+struct phase_result_t {
+    string name;
+    vector<long long> samples_ns;
+
+    long long median() const {
+        vector<long long> sorted = samples_ns;
+        sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+    long long min() const {
+        return *min_element(samples_ns.begin(), samples_ns.end());
+    }
+};
+
+// Phases in the order they were first recorded
+class phase_table_t {
+  public:
+    void add(const string& name, long long ns) {
+        for (phase_result_t& phase : phases) {
+            if (phase.name == name) {
+                phase.samples_ns.push_back(ns);
+                return;
+            }
+        }
+        phases.push_back({name, {ns}});
+    }
+    const vector<phase_result_t>& results() const { return phases; }
+
+  private:
+    vector<phase_result_t> phases;
+};
+
+// Swallows execute_program output so the terminal does not dominate timings.
+class null_buffer_t : public streambuf {
+  protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// Discards output but remembers when the first byte was written.
+class first_output_buffer_t : public streambuf {
+  public:
+    chrono::steady_clock::time_point first;
+    bool written = false;
+
+  protected:
+    int overflow(int c) override { mark(); return c; }
+    streamsize xsputn(const char*, streamsize n) override { mark(); return n; }
+
+  private:
+    void mark() {
+        if (!written) first = chrono::steady_clock::now();
+        written = true;
+    }
+};
+
+template <typename F>
+long long time_ns(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
+volatile uint32_t calibration_sink;
+
+// Sorts pseudo-random integers; the same work in every run and on every
+// build of the parser
+void calibration_work() {
+    vector<uint32_t> values(1 << 18);
+    uint32_t x = 2463534242u;
+    for (uint32_t& v : values) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        v = x;
+    }
+    sort(values.begin(), values.end());
+    calibration_sink = values[values.size() / 2];
+}
+
+// Looks up "median_ns" of the named phase in a file written by this tool;
+// -1 if the file has no such phase.
+long long baseline_median(const string& json, const string& phase) {
+    size_t pos = json.find("\"phase\": \"" + phase + "\"");
+    if (pos == string::npos) return -1;
+    pos = json.find("\"median_ns\":", pos);
+    if (pos == string::npos) return -1;
+    return atoll(json.c_str() + pos + 12);
+}
+
+// Adds a constant term to every stride-th declaration of a POLY section
+string edit_declarations(const string& section, size_t stride) {
+    string edited;
+    size_t decl = 0;
+    for (char c : section) {
+        edited += c;
+        if (c == '=' && decl++ % stride == 0) edited += " 1 +";
+    }
+    return edited;
+}
+
+void usage(const char* prog) {
+    cerr << "usage: " << prog << " [--polys N] [--terms N] [--depth N] [--exponent N]\n"
+         << "       [--statements N] [--inputs N] [--seed N] [--iterations N]\n"
+         << "       [--generate] [--json FILE] [--baseline FILE] [--tolerance FRACTION]\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    gen_config_t config;
+    int iterations = 11;
+    bool generate_only = false;
+    string json_file;
+    string baseline_file;
+    double tolerance = 0.25;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--generate") {
+            generate_only = true;
+        } else if (arg == "--polys" && has_value) {
+            config.polys = atoi(argv[++i]);
+        } else if (arg == "--terms" && has_value) {
+            config.terms = atoi(argv[++i]);
+        } else if (arg == "--depth" && has_value) {
+            config.depth = atoi(argv[++i]);
+        } else if (arg == "--exponent" && has_value) {
+            config.exponent = atoi(argv[++i]);
+        } else if (arg == "--statements" && has_value) {
+            config.statements = atoi(argv[++i]);
+        } else if (arg == "--inputs" && has_value) {
+            config.inputs = atoi(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            config.seed = (unsigned int) atoi(argv[++i]);
+        } else if (arg == "--iterations" && has_value) {
+            iterations = max(1, atoi(argv[++i]));
+        } else if (arg == "--json" && has_value) {
+            json_file = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_file = argv[++i];
+        } else if (arg == "--tolerance" && has_value) {
+            tolerance = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    string program = generate_program(config);
+    if (generate_only) {
+        cout << program;
+        return 0;
+    }
+
+    // High powers of parenthesized lists, univariate and multivariate
+    string expand_program = "TASKS\n5\nPOLY\n"
+                            "F = (x^3 + 2 x + 1)^2000;\n"
+                            "G(x, y) = (x y + 2 x - y + 3)^120 (x - 1)^40;\n"
+                            "EXECUTE\nINPUT x;\nINPUTS\n1\n";
+    dense_poly_t mul_a(4096), mul_b(4096);
+    for (size_t i = 0; i < mul_a.size(); i++) {
+        mul_a[i] = (uint32_t) (i * 2654435761u);
+        mul_b[i] = (uint32_t) (i * 40503u + 7);
+    }
+
+    // A dense univariate body of degree 1024 evaluated at 4096 points
+    string batch_program = "TASKS\n5\nPOLY\nF = x^1024";
+    for (int e = 1023; e > 0; e--) {
+        batch_program += " + " + to_string(e * 7919 % 100003) + " x^" + to_string(e);
+    }
+    batch_program += " + 1;\nEXECUTE\nINPUT x;\nINPUTS\n1\n";
+    vector<vector<long long>> batch_args(1);
+    for (long long i = 0; i < 4096; i++) {
+        batch_args[0].push_back(i * 2654435761LL % 1000000007);
+    }
+
+    // One body of 2000 terms over three parameters, called 300 times
+    string wide_program = "TASKS\n2\nPOLY\nW(x, y, z) = 1";
+    for (int t = 1; t < 2000; t++) {
+        wide_program += (t % 3 ? " + " : " - ") + to_string(t * 7919 % 100003) + " x^" + to_string(t % 7)
+                        + " y^" + to_string(t / 7 % 5) + " z^" + to_string(t / 35 % 9);
+    }
+    wide_program += ";\nEXECUTE\nINPUT a;\nINPUT b;\n";
+    for (int s = 0; s < 300; s++) {
+        wide_program += (s % 2 ? "a = W(a, b, " : "b = W(b, a, ") + to_string(s % 10) + ");\nOUTPUT a;\n";
+    }
+    wide_program += "INPUTS\n3 4\n";
+
+    gen_config_t unchained_config = config;
+    unchained_config.chained = false;
+    unchained_config.max_input = 9;
+    string unchained_program = generate_program(unchained_config);
+
+    // Bodies one level deep with squares at most, on inputs of at most 3:
+    // no value reaches 2^31, so checked arithmetic never leaves 64 bits and
+    // int execution never wraps
+    gen_config_t bounded_config = unchained_config;
+    bounded_config.depth = 1;
+    bounded_config.exponent = 2;
+    bounded_config.max_input = 3;
+    string bounded_program = generate_program(bounded_config);
+    long long bounded_promotions = 0;
+    long long overflowing_promotions = 0;
+
+    // One input swept over ten values on a 100k-statement program
+    gen_config_t sweep_config = unchained_config;
+    sweep_config.statements = 100000;
+    string sweep_program = generate_program(sweep_config);
+    const int SWEEP_VALUES = 10;
+
+    phase_table_t phases;
+    size_t tokens = 0;
+    null_buffer_t null_buffer;
+    ostream null_out(&null_buffer);
+
+    for (int it = 0; it < iterations; it++) {
+        phases.add("calibration", time_ns(calibration_work));
+
+        istringstream in(program);
+        Parser* parser = nullptr;
+        phases.add("lex", time_ns([&] { parser = new Parser(in); }));
+        tokens = parser->token_count();
+        phases.add("parse", time_ns([&] { parser->parse_program(); }));
+        // Semantic Error Codes 1 to 4 and Warning Code 1 are checked while
+        // parsing, so they are timed again on their own
+        phases.add("semantic", time_ns([&] { parser->recheck_semantics(); }));
+        phases.add("useless_assignments", time_ns([&] { parser->check_useless_assignments(); }));
+        phases.add("degree", time_ns([&] { parser->compute_degrees(); }));
+
+        parser->out = &null_out;
+        phases.add("execute", time_ns([&] { parser->execute_program(); }));
+        parser->use_jit = true;
+        phases.add("execute_jit", time_ns([&] { parser->execute_program(); }));
+        delete parser;
+
+        // Checked arithmetic against int where nothing overflows, then on
+        // the unchained program, where many statements go through BigInt
+        istringstream bounded_in(bounded_program);
+        Parser bounded(bounded_in);
+        bounded.parse_program();
+        bounded.out = &null_out;
+        phases.add("execute_bounded", time_ns([&] { bounded.execute_program(); }));
+        bounded.arith_mode = ARITH_CHECKED;
+        phases.add("execute_checked", time_ns([&] { bounded.execute_program(); }));
+        bounded_promotions = bounded.checked_promotions;
+
+        istringstream unchained_in(unchained_program);
+        Parser unchained(unchained_in);
+        unchained.parse_program();
+        unchained.out = &null_out;
+        phases.add("execute_unchained", time_ns([&] { unchained.execute_program(); }));
+        unchained.arith_mode = ARITH_CHECKED;
+        phases.add("execute_checked_overflowing", time_ns([&] { unchained.execute_program(); }));
+        overflowing_promotions = unchained.checked_promotions;
+        unchained.arith_mode = ARITH_MOD;
+        unchained.mont = Montgomery(1000000007);
+        phases.add("execute_mod", time_ns([&] { unchained.execute_program(); }));
+
+        // Incremental reparse after editing one declaration in a hundred
+        size_t begin, end;
+        int first_line;
+        if (Parser::find_poly_section(program, begin, end, first_line)) {
+            string section = program.substr(begin, end - begin);
+            string edited = edit_declarations(section, 100);
+            istringstream incremental_in(program);
+            Parser incremental(incremental_in);
+            incremental.parse_program();
+            incremental.reparse_poly_section(section, first_line);
+            phases.add("reparse_1pct", time_ns([&] { incremental.reparse_poly_section(edited, first_line); }));
+        }
+
+        istringstream threaded_in(program);
+        Parser threaded(threaded_in);
+        threaded.parse_threads = 4;
+        phases.add("parse_4_threads", time_ns([&] { threaded.parse_program(); }));
+
+        istringstream threaded_lex_in(program);
+        phases.add("lex_4_threads", time_ns([&] { Parser threaded_lex(threaded_lex_in, 4); }));
+
+        // Source text to the end of the tasks, with the lexer running either
+        // before the parser or alongside it
+        for (int pipelined = 0; pipelined < 2; pipelined++) {
+            istringstream run_in(program);
+            first_output_buffer_t first_output;
+            ostream run_out(&first_output);
+            auto start = chrono::steady_clock::now();
+            phases.add(pipelined ? "run_pipelined" : "run", time_ns([&] {
+                Parser run(run_in, 1, pipelined != 0);
+                run.out = &run_out;
+                run.parse_program();
+                run.run_tasks();
+            }));
+            long long first_ns = chrono::duration_cast<chrono::nanoseconds>(first_output.first - start).count();
+            phases.add(pipelined ? "first_output_pipelined" : "first_output", first_output.written ? first_ns : 0);
+        }
+
+        istringstream expand_in(expand_program);
+        Parser expanding(expand_in);
+        expanding.parse_program();
+        phases.add("expand", time_ns([&] { expanding.expand_polys(null_out); }));
+        phases.add("poly_mul_4k", time_ns([&] { poly_mul(mul_a, mul_b); }));
+        phases.add("poly_mul_4k_schoolbook", time_ns([&] { poly_mul(mul_a, mul_b, POLY_MUL_SCHOOLBOOK); }));
+
+        istringstream batch_in(batch_program);
+        Parser batch(batch_in);
+        batch.parse_program();
+        batch.arith_mode = ARITH_MOD;
+        batch.mont = Montgomery(1000000007);
+        for (int multipoint = 0; multipoint < 2; multipoint++) {
+            batch.use_multipoint = multipoint != 0;
+            phases.add(multipoint ? "mod_batch_multipoint" : "mod_batch", time_ns([&] { batch.evaluate_poly_mod_batch("F", batch_args); }));
+        }
+
+        istringstream wide_in(wide_program);
+        Parser wide(wide_in);
+        wide.parse_program();
+        wide.out = &null_out;
+        wide.wide_kernel = WIDE_OFF;
+        phases.add("execute_wide_by_term", time_ns([&] { wide.execute_program(); }));
+        wide.wide_kernel = WIDE_AUTO;
+        phases.add("execute_wide", time_ns([&] { wide.execute_program(); }));
+
+        istringstream sweep_in(sweep_program);
+        Parser sweep(sweep_in);
+        sweep.parse_program();
+        sweep.out = &null_out;
+        phases.add("input_sweep_full", time_ns([&] {
+            for (int value = 0; value < SWEEP_VALUES; value++) {
+                sweep.set_input(0, value);
+                sweep.execute_program();
+            }
+        }));
+        sweep.execute_incremental();
+        phases.add("input_sweep_incremental", time_ns([&] {
+            for (int value = 0; value < SWEEP_VALUES; value++) {
+                sweep.set_input(0, value);
+                sweep.execute_incremental();
+            }
+        }));
+    }
+
+    ostringstream json;
+    json << "{\n"
+         << "  \"config\": {\"polys\": " << config.polys << ", \"terms\": " << config.terms
+         << ", \"depth\": " << config.depth << ", \"exponent\": " << config.exponent
+         << ", \"statements\": " << config.statements << ", \"inputs\": " << config.inputs
+         << ", \"seed\": " << config.seed << "},\n"
+         << "  \"program_bytes\": " << program.size() << ",\n"
+         << "  \"tokens\": " << tokens << ",\n"
+         << "  \"iterations\": " << iterations << ",\n"
+         << "  \"checked_promotions\": {\"execute_checked\": " << bounded_promotions
+         << ", \"execute_checked_overflowing\": " << overflowing_promotions << "},\n"
+         << "  \"results\": [\n";
+    const vector<phase_result_t>& results = phases.results();
+    for (size_t i = 0; i < results.size(); i++) {
+        json << "    {\"phase\": \"" << results[i].name << "\", \"median_ns\": " << results[i].median()
+             << ", \"min_ns\": " << results[i].min() << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n"
+         << "}\n";
+
+    if (json_file.empty()) {
+        cout << json.str();
+    } else {
+        ofstream(json_file) << json.str();
+    }
+
+    if (baseline_file.empty()) return 0;
+
+    ifstream baseline_in(baseline_file);
+    if (!baseline_in) {
+        cerr << "cannot read baseline " << baseline_file << endl;
+        return 1;
+    }
+    stringstream baseline;
+    baseline << baseline_in.rdbuf();
+
+    long long base_calibration = baseline_median(baseline.str(), "calibration");
+    if (base_calibration <= 0) {
+        cerr << "MISSING calibration: not in baseline " << baseline_file
+             << " (run ./run_bench.sh --update-baseline)" << endl;
+        return 1;
+    }
+    // how much slower this run's machine is than the baseline's
+    double scale = 1.0;
+    for (const phase_result_t& phase : results) {
+        if (phase.name == "calibration") scale = (double) phase.median() / (double) base_calibration;
+    }
+
+    int regressions = 0;
+    for (const phase_result_t& phase : results) {
+        if (phase.name == "calibration") continue;
+        long long base = baseline_median(baseline.str(), phase.name);
+        if (base < 0) {
+            cerr << "MISSING " << phase.name << ": not in baseline " << baseline_file
+                 << " (run ./run_bench.sh --update-baseline)" << endl;
+            regressions++;
+            continue;
+        }
+        if (base == 0) continue;
+        double ratio = (double) phase.median() / (base * scale);
+        if (ratio > 1.0 + tolerance) {
+            cerr << "REGRESSION " << phase.name << ": " << phase.median() << " ns vs baseline "
+                 << base << " ns, " << (long long) (base * scale) << " ns after calibration ("
+                 << ratio << "x)" << endl;
+            regressions++;
+        }
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Synthetic program generator for the benchmark suite.
+ */
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "program_gen.h"
+
+using namespace std;
+
+namespace {
+
+const int VAR_POOL = 64;
+
+struct generator_t {
+    const gen_config_t& config;
+    mt19937 rng;
+
+    explicit generator_t(const gen_config_t& config) : config(config), rng(config.seed) {}
+
+    int uniform(int lo, int hi) {
+        return uniform_int_distribution<int>(lo, hi)(rng);
+    }
+
+    string param(int count) {
+        return "x" + to_string(uniform(0, count - 1));
+    }
+
+    // The first monomial of the first term nests until the requested depth
+    // is reached, so every body has exactly config.depth levels.
+    string term_list(int params, int depth, int terms) {
+        string out;
+        for (int t = 0; t < terms; t++) {
+            if (t > 0) {
+                out += uniform(0, 2) ? " + " : " - ";
+            }
+            out += to_string(uniform(1, 9));
+            int monomials = uniform(1, 2);
+            for (int m = 0; m < monomials; m++) {
+                out += " ";
+                if (t == 0 && m == 0 && depth > 0) {
+                    out += "(" + term_list(params, depth - 1, 2) + ")";
+                } else {
+                    out += param(params);
+                }
+                int e = uniform(1, max(1, config.exponent));
+                if (e > 1) {
+                    out += "^" + to_string(e);
+                }
+            }
+        }
+        return out;
+    }
+};
+
+}  // namespace
+
+string generate_program(const gen_config_t& config) {
+    generator_t gen(config);
+    string out = "TASKS\n1 2\nPOLY\n";
+
+    int polys = max(1, config.polys);
+    vector<int> arity(polys);
+    for (int p = 0; p < polys; p++) {
+        arity[p] = 1 + p % 4;
+        out += "F" + to_string(p) + "(";
+        for (int i = 0; i < arity[p]; i++) {
+            out += (i ? ", x" : "x") + to_string(i);
+        }
+        out += ") = " + gen.term_list(arity[p], config.depth, max(1, config.terms)) + ";\n";
+    }
+
+    out += "EXECUTE\n";
+    int inputs = max(1, config.inputs);
+    vector<bool> is_initialized(VAR_POOL, false);
+    vector<int> initialized;
+    for (int i = 0; i < inputs; i++) {
+        int v = i % VAR_POOL;
+        out += "INPUT v" + to_string(v) + ";\n";
+        if (!is_initialized[v]) {
+            is_initialized[v] = true;
+            initialized.push_back(v);
+        }
+    }
+    // only initialized variables are read, so no Warning Code 1 is produced
+    for (int s = 0; s < config.statements; s++) {
+        if (s % 10 == 9) {
+            out += "OUTPUT v" + to_string(initialized[gen.uniform(0, initialized.size() - 1)]) + ";\n";
+            continue;
+        }
+        int p = gen.uniform(0, polys - 1);
+        int lhs = config.chained ? gen.uniform(0, VAR_POOL - 1) : VAR_POOL + gen.uniform(0, VAR_POOL - 1);
+        out += "v" + to_string(lhs) + " = F" + to_string(p) + "(";
+        for (int i = 0; i < arity[p]; i++) {
+            out += (i ? ", v" : "v") + to_string(initialized[gen.uniform(0, initialized.size() - 1)]);
+        }
+        out += ");\n";
+        if (!config.chained) {
+            // arguments stay INPUT variables, so values never compound
+            continue;
+        }
+        if (!is_initialized[lhs]) {
+            is_initialized[lhs] = true;
+            initialized.push_back(lhs);
+        }
+    }
+
+    out += "INPUTS\n";
+    for (int i = 0; i < inputs; i++) {
+        out += (i ? " " : "") + to_string(gen.uniform(0, config.max_input));
+    }
+    out += "\n";
+    return out;
+}
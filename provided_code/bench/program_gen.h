@@ -0,0 +1,26 @@
+/*
+ * Synthetic program generator for the benchmark suite.
+ *
+ * Produces valid programs (no syntax or semantic errors) whose size is
+ * controlled by the fields of gen_config_t.
+ */
+#ifndef __PROGRAM_GEN_H__
+#define __PROGRAM_GEN_H__
+
+#include <string>
+
+struct gen_config_t {
+    int polys = 64;           // number of POLY declarations
+    int terms = 8;            // terms per top-level term list
+    int depth = 2;            // nesting depth of parenthesized term lists
+    int exponent = 4;         // largest exponent on a monomial
+    int statements = 10000;   // assignments and OUTPUTs in EXECUTE
+    int inputs = 100;         // INPUT statements and INPUTS values
+    int max_input = 99;       // INPUTS values are drawn from [0, max_input]
+    bool chained = true;      // arguments may be results of earlier assignments
+    unsigned int seed = 1;
+};
+
+std::string generate_program(const gen_config_t& config);
+
+#endif  //__PROGRAM_GEN_H__
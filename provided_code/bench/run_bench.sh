@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# Builds the benchmark suite and compares it against baseline.json.
+#
+#   ./run_bench.sh                   run and compare against the baseline
+#   ./run_bench.sh --update-baseline run and overwrite the baseline
+#
+# Any other arguments are passed to the bench binary, e.g. --statements 100000.
+# Phases are compared with the baseline relative to the calibration phase,
+# which absorbs most of the difference between machines; a baseline recorded
+# elsewhere is still best refreshed before relying on small changes.
+#
+
+cd "$(dirname "$0")"
+
+# Every source next to parser.cc is part of the build; PARSER_NO_MAIN drops
+# the command-line main().
+g++ -std=c++17 -O2 -DPARSER_NO_MAIN -o bench bench.cc program_gen.cc ../*.cc || exit 1
+
+if [ "$1" = "--update-baseline" ]; then
+    shift
+    ./bench "$@" --json baseline.json || exit 1
+    cat baseline.json
+    exit 0
+fi
+
+if [ ! -e baseline.json ]; then
+    ./bench "$@"
+    exit $?
+fi
+
+# A regression has to show up in three runs in a row; one run on a busy
+# machine can be slow on its own
+for attempt in 1 2 3; do
+    ./bench "$@" --baseline baseline.json && exit 0
+    echo "run $attempt of 3 failed the baseline check" >&2
+done
+exit 1
@@ -0,0 +1,60 @@
+#!/bin/bash
+#
+# Compares the tree walker against the --jit tier on a generated program.
+# Run from the directory containing a.out, like test1.sh:
+#
+#   ./bench_jit.sh [statements] [terms per polynomial] [exponent]
+#
+
+if [ ! -x "./a.out" ]; then
+    echo "Error: a.out not found or not executable!"
+    exit 1
+fi
+
+statements=${1:-100000}
+terms=${2:-16}
+exponent=${3:-9}
+
+program=$(mktemp)
+trap 'rm -f ${program}' EXIT
+
+awk -v statements=${statements} -v terms=${terms} -v exponent=${exponent} 'BEGIN {
+    print "TASKS"
+    print "2"
+    print "POLY"
+    for (p = 0; p < 4; p++) {
+        body = ""
+        for (t = 0; t < terms; t++) {
+            op = (t == 0) ? "" : ((t % 3 == 0) ? " - " : " + ")
+            body = body op (t + 1) " x^" (t % exponent + 1) " y (z + " t ")^" (exponent - t % exponent)
+        }
+        print "F" p "(x, y, z) = " body ";"
+    }
+    print "EXECUTE"
+    print "INPUT a;"
+    print "INPUT b;"
+    print "INPUT c;"
+    for (s = 0; s < statements; s++) {
+        print "a = F" (s % 4) "(a, b, c);"
+    }
+    print "OUTPUT a;"
+    print "INPUTS"
+    print "3 5 7"
+}' > ${program}
+
+run() {
+    local TIMEFORMAT=%R
+    { time ./a.out "$@" < ${program} > /dev/null; } 2>&1
+}
+
+tree=$(run)
+jit=$(run --jit)
+
+if ! cmp -s <(./a.out < ${program}) <(./a.out --jit < ${program}); then
+    echo "Error: --jit output differs from the tree walker!"
+    exit 1
+fi
+
+echo "statements=${statements} terms=${terms} exponent=${exponent}"
+echo "tree walker: ${tree} s"
+echo "jit:         ${jit} s"
@@ -0,0 +1,162 @@
+/*
+ * Arbitrary-precision signed integer for --arith=checked.
+ */
+#include <algorithm>
+
+#include "bigint.h"
+
+using namespace std;
+
+BigInt::BigInt(long long value)
+{
+    negative = value < 0;
+    unsigned long long u = negative ? 0ull - (unsigned long long) value : (unsigned long long) value;
+    while (u != 0) {
+        magnitude.push_back((uint32_t) u);
+        u >>= 32;
+    }
+}
+
+bool BigInt::fits_int64() const
+{
+    if (magnitude.size() <= 1) return true;
+    if (magnitude.size() > 2) return false;
+    unsigned long long u = ((unsigned long long) magnitude[1] << 32) | magnitude[0];
+    return negative ? u <= (1ull << 63) : u < (1ull << 63);
+}
+
+long long BigInt::to_int64() const
+{
+    unsigned long long u = 0;
+    for (size_t i = min<size_t>(magnitude.size(), 2); i > 0; --i) {
+        u = (u << 32) | magnitude[i - 1];
+    }
+    return negative ? (long long) (0ull - u) : (long long) u;
+}
+
+string BigInt::to_string() const
+{
+    if (magnitude.empty()) return "0";
+    vector<uint32_t> rest = magnitude;
+    vector<uint32_t> chunks;   // base 10^9, least significant first
+    while (!rest.empty()) {
+        unsigned long long remainder = 0;
+        for (size_t i = rest.size(); i > 0; --i) {
+            unsigned long long cur = (remainder << 32) | rest[i - 1];
+            rest[i - 1] = (uint32_t) (cur / 1000000000ull);
+            remainder = cur % 1000000000ull;
+        }
+        chunks.push_back((uint32_t) remainder);
+        while (!rest.empty() && rest.back() == 0) rest.pop_back();
+    }
+    string out = negative ? "-" : "";
+    out += std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i > 0; --i) {
+        string part = std::to_string(chunks[i - 1]);
+        out += string(9 - part.size(), '0') + part;
+    }
+    return out;
+}
+
+int BigInt::compare_magnitude(const vector<uint32_t>& a, const vector<uint32_t>& b)
+{
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (size_t i = a.size(); i > 0; --i) {
+        if (a[i - 1] != b[i - 1]) return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+    return 0;
+}
+
+vector<uint32_t> BigInt::add_magnitude(const vector<uint32_t>& a, const vector<uint32_t>& b)
+{
+    vector<uint32_t> out(max(a.size(), b.size()) + 1, 0);
+    unsigned long long carry = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        unsigned long long sum = carry;
+        if (i < a.size()) sum += a[i];
+        if (i < b.size()) sum += b[i];
+        out[i] = (uint32_t) sum;
+        carry = sum >> 32;
+    }
+    while (!out.empty() && out.back() == 0) out.pop_back();
+    return out;
+}
+
+// requires |a| >= |b|
+vector<uint32_t> BigInt::sub_magnitude(const vector<uint32_t>& a, const vector<uint32_t>& b)
+{
+    vector<uint32_t> out(a.size(), 0);
+    long long borrow = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        long long diff = (long long) a[i] - borrow - (i < b.size() ? (long long) b[i] : 0);
+        borrow = diff < 0;
+        out[i] = (uint32_t) (diff + (borrow ? (1ll << 32) : 0));
+    }
+    while (!out.empty() && out.back() == 0) out.pop_back();
+    return out;
+}
+
+vector<uint32_t> BigInt::mul_magnitude(const vector<uint32_t>& a, const vector<uint32_t>& b)
+{
+    if (a.empty() || b.empty()) return {};
+    vector<uint32_t> out(a.size() + b.size(), 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        unsigned long long carry = 0;
+        for (size_t j = 0; j < b.size(); j++) {
+            unsigned long long cur = (unsigned long long) a[i] * b[j] + out[i + j] + carry;
+            out[i + j] = (uint32_t) cur;
+            carry = cur >> 32;
+        }
+        out[i + b.size()] = (uint32_t) carry;
+    }
+    while (!out.empty() && out.back() == 0) out.pop_back();
+    return out;
+}
+
+BigInt BigInt::signed_sum(const BigInt& a, const BigInt& b, bool negate_b)
+{
+    bool b_negative = negate_b ? !b.negative : b.negative;
+    BigInt out;
+    if (a.negative == b_negative) {
+        out.magnitude = add_magnitude(a.magnitude, b.magnitude);
+        out.negative = a.negative;
+    } else if (compare_magnitude(a.magnitude, b.magnitude) >= 0) {
+        out.magnitude = sub_magnitude(a.magnitude, b.magnitude);
+        out.negative = a.negative;
+    } else {
+        out.magnitude = sub_magnitude(b.magnitude, a.magnitude);
+        out.negative = b_negative;
+    }
+    if (out.magnitude.empty()) out.negative = false;
+    return out;
+}
+
+BigInt BigInt::operator+(const BigInt& other) const
+{
+    return signed_sum(*this, other, false);
+}
+
+BigInt BigInt::operator-(const BigInt& other) const
+{
+    return signed_sum(*this, other, true);
+}
+
+BigInt BigInt::operator*(const BigInt& other) const
+{
+    BigInt out;
+    out.magnitude = mul_magnitude(magnitude, other.magnitude);
+    out.negative = !out.magnitude.empty() && (negative != other.negative);
+    return out;
+}
+
+BigInt BigInt::pow(unsigned int exponent) const
+{
+    BigInt result(1);
+    BigInt base = *this;
+    while (exponent != 0) {
+        if (exponent & 1) result = result * base;
+        exponent >>= 1;
+        if (exponent != 0) base = base * base;
+    }
+    return result;
+}
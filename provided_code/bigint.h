@@ -0,0 +1,38 @@
+/*
+ * Arbitrary-precision signed integer used when checked evaluation
+ * (--arith=checked) overflows 64 bits. Only the operations polynomial
+ * evaluation needs are provided.
+ */
+#ifndef __BIGINT_H__
+#define __BIGINT_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class BigInt {
+  public:
+    BigInt() = default;
+    BigInt(long long value);
+
+    bool fits_int64() const;
+    long long to_int64() const;
+    std::string to_string() const;
+
+    BigInt operator+(const BigInt& other) const;
+    BigInt operator-(const BigInt& other) const;
+    BigInt operator*(const BigInt& other) const;
+    BigInt pow(unsigned int exponent) const;
+
+  private:
+    bool negative = false;
+    std::vector<uint32_t> magnitude;   // little-endian limbs, no leading zeros
+
+    static int compare_magnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+    static std::vector<uint32_t> add_magnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+    static std::vector<uint32_t> sub_magnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+    static std::vector<uint32_t> mul_magnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+    static BigInt signed_sum(const BigInt& a, const BigInt& b, bool negate_b);
+};
+
+#endif  //__BIGINT_H__
@@ -0,0 +1,211 @@
+/*
+ * Overflow-checked evaluation (--arith=checked).
+ *
+ * The program is lowered as for int execution (exec_program.cc) and every
+ * body is evaluated over its flat arrays in 64-bit integers with
+ * __builtin_*_overflow checks. When one overflows, only that statement is
+ * re-evaluated with BigInt, and its result is kept in big_memory until a
+ * later assignment brings the slot back into 64-bit range.
+ */
+#include <iostream>
+
+#include "parser.h"
+
+using namespace std;
+
+static bool checked_pow(long long base, unsigned int exponent, long long& result)
+{
+    long long r = 1;
+    while (exponent != 0) {
+        if ((exponent & 1) && __builtin_mul_overflow(r, base, &r)) return false;
+        exponent >>= 1;
+        if (exponent != 0 && __builtin_mul_overflow(base, base, &base)) return false;
+    }
+    result = r;
+    return true;
+}
+
+// Evaluates the body in 64 bits; false as soon as any step overflows
+bool Parser::checked_eval(const flat_poly_t& flat, const long long* args, long long& result) {
+    checked_lists.resize(flat.list_end.size());
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        long long sum = 0;
+        for (; t < flat.list_end[k]; t++) {
+            long long product = flat.coefficient[t];
+            for (; m < flat.term_end[t]; m++) {
+                long long base;
+                switch (flat.operand_kind[m]) {
+                    case FLAT_PARAM:
+                        base = args[flat.operand[m]];
+                        break;
+                    case FLAT_FREE: {
+                        int slot = flat.free_slots[flat.operand[m]];
+                        base = (slot >= 0) ? memory64[slot] : 0;
+                        break;
+                    }
+                    default:
+                        base = checked_lists[flat.operand[m]];
+                        break;
+                }
+                long long power;
+                if (!checked_pow(base, (unsigned int) flat.exponent[m], power)) return false;
+                if (__builtin_mul_overflow(product, power, &product)) return false;
+            }
+            bool overflow = flat.negate[t] ? __builtin_sub_overflow(sum, product, &sum)
+                                           : __builtin_add_overflow(sum, product, &sum);
+            if (overflow) return false;
+        }
+        checked_lists[k] = sum;
+    }
+    result = checked_lists.back();
+    return true;
+}
+
+BigInt Parser::big_eval(const flat_poly_t& flat, const vector<BigInt>& args) {
+    vector<BigInt> lists(flat.list_end.size());
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        BigInt sum(0);
+        for (; t < flat.list_end[k]; t++) {
+            BigInt product(flat.coefficient[t]);
+            for (; m < flat.term_end[t]; m++) {
+                BigInt base(0);
+                switch (flat.operand_kind[m]) {
+                    case FLAT_PARAM:
+                        base = args[flat.operand[m]];
+                        break;
+                    case FLAT_FREE: {
+                        int slot = flat.free_slots[flat.operand[m]];
+                        if (slot >= 0) base = big_value(slot);
+                        break;
+                    }
+                    default:
+                        base = lists[flat.operand[m]];
+                        break;
+                }
+                product = product * base.pow((unsigned int) flat.exponent[m]);
+            }
+            sum = flat.negate[t] ? sum - product : sum + product;
+        }
+        lists[k] = sum;
+    }
+    return lists.back();
+}
+
+BigInt Parser::big_value(int slot) {
+    auto big = big_memory.find(slot);
+    return (big != big_memory.end()) ? big->second : BigInt(memory64[slot]);
+}
+
+void Parser::checked_assign(int lhs, const flat_poly_t& flat, const instr_arg_t* arg, unsigned int arg_count) {
+    checked_args.resize(arg_count);
+    bool big_args = false;
+    for (unsigned int i = 0; i < arg_count; i++) {
+        if (arg[i].slot < 0) {
+            checked_args[i] = arg[i].value;
+            continue;
+        }
+        checked_args[i] = memory64[arg[i].slot];
+        big_args = big_args || (!big_memory.empty() && big_memory.count(arg[i].slot));
+    }
+    if (!big_args && !big_memory.empty()) {
+        for (int slot : flat.free_slots) {
+            big_args = big_args || (slot >= 0 && big_memory.count(slot));
+        }
+    }
+
+    long long result;
+    if (!big_args && checked_eval(flat, checked_args.data(), result)) {
+        memory64[lhs] = result;
+        if (!big_memory.empty()) big_memory.erase(lhs);
+        return;
+    }
+
+    // slow path: this statement needs more than 64 bits
+    checked_promotions++;
+    vector<BigInt> big_values(arg_count);
+    for (unsigned int i = 0; i < arg_count; i++) {
+        big_values[i] = (arg[i].slot < 0) ? BigInt(arg[i].value) : big_value(arg[i].slot);
+    }
+    BigInt big_result = big_eval(flat, big_values);
+    if (big_result.fits_int64()) {
+        memory64[lhs] = big_result.to_int64();
+        big_memory.erase(lhs);
+    } else {
+        big_memory[lhs] = big_result;
+    }
+}
+
+// Generic form of an assignment that lower_program() left as a statement
+void Parser::checked_statement(stmt_t* current) {
+    poly_eval_t* eval = static_cast<poly_eval_t*>(current->eval);
+    const vector<string>& params = poly_params[eval->name];
+    if (params.size() != eval->args.size()) {
+        cerr << "[fatal] wrong number of arguments for poly " << eval->name << endl;
+        throw parser_exit_t{1};
+    }
+    if (stats) {
+        stats->poly_evaluations++;
+        stats->multiplications += poly_mult_count[eval->name];
+    }
+    vector<instr_arg_t> args;
+    for (const string& actual : eval->args) {
+        if (is_literal(actual)) {
+            args.push_back({-1, stoi(actual)});
+        } else {
+            args.push_back({frame[argument_id(actual)], 0});
+        }
+    }
+    unsigned long long start = profiler ? Profiler::now() : 0;
+    checked_assign(frame[current->lhs], poly_bodies[eval->name]->flat, args.data(), (unsigned int) args.size());
+    if (profiler) {
+        profiler->record(eval->name, current->line_no, poly_mult_count[eval->name], Profiler::now() - start);
+    }
+}
+
+void Parser::execute_program_checked() {
+    memory64.assign(memory.size(), 0);
+    big_memory.clear();
+    for (size_t i = 0; i < input_vars_in_order.size(); ++i) {
+        memory64[frame_slot(input_vars_in_order[i])] = input_value(i);
+    }
+    lower_program();
+
+    OutputWriter writer(out, false);
+    for (const instr_t& instr : program) {
+        switch (instr.kind) {
+            case INSTR_OUTPUT: {
+                auto big = big_memory.find(instr.var);
+                if (big != big_memory.end()) {
+                    writer.write_line(big->second.to_string());
+                } else {
+                    writer.write_int64(memory64[instr.var]);
+                }
+                break;
+            }
+            case INSTR_EVAL:
+            case INSTR_EVAL_JIT: {
+                // native code works in int, so it is never used here
+                const exec_poly_t& poly = exec_polys[instr.eval.poly];
+                if (stats) {
+                    stats->poly_evaluations++;
+                    stats->multiplications += poly.multiplications;
+                }
+                unsigned long long start = profiler ? Profiler::now() : 0;
+                checked_assign(instr.eval.lhs, *poly.flat, &exec_args[instr.eval.arg_begin], instr.eval.arg_count);
+                if (profiler) {
+                    profiler->record(*poly.name, instr.line_no, poly.multiplications, Profiler::now() - start);
+                }
+                break;
+            }
+            case INSTR_STMT:
+                checked_statement(instr.stmt);
+                break;
+            case INSTR_HALT:
+                return;
+        }
+    }
+}
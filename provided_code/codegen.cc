@@ -0,0 +1,176 @@
+/*
+ * Ahead-of-time backend (--emit-cpp).
+ *
+ * Translates the parsed POLY and EXECUTE sections into a standalone C++
+ * program: one inline function per polynomial and straight-line code over a
+ * fixed-size slot array for the statement list. Arithmetic is done on
+ * unsigned int so the compiled program wraps exactly like execute_program.
+ */
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "parser.h"
+
+using namespace std;
+
+namespace {
+
+struct emit_context_t {
+    const vector<string>* params;
+    const map<string, int>* location_table;
+    const vector<int>* frame;
+    // free variables an argument binds to location 0 at run time, with the
+    // index of the flag the emitted program sets when that happens
+    const map<string, int>* late_bound;
+};
+
+string emit_term_list(const emit_context_t& ctx, term_list_t* term_list);
+
+string emit_primary(const emit_context_t& ctx, primary_t* primary) {
+    if (primary->kind == TERM_LIST) {
+        return emit_term_list(ctx, primary->term_list);
+    }
+    int idx = param_index(*ctx.params, primary->var_name);
+    if (idx >= 0) {
+        return "p" + to_string(idx);
+    }
+    // free variables read the variable's slot, or 0 if it has none
+    auto loc = ctx.location_table->find(primary->var_name);
+    if (loc != ctx.location_table->end()) {
+        return "m[" + to_string((*ctx.frame)[loc->second]) + "]";
+    }
+    auto late = ctx.late_bound->find(primary->var_name);
+    if (late != ctx.late_bound->end()) {
+        return "(bound[" + to_string(late->second) + "] ? m[" + to_string((*ctx.frame)[0]) + "] : 0u)";
+    }
+    return "0u";
+}
+
+string emit_monomial(const emit_context_t& ctx, monomial_t* monomial) {
+    if (monomial->exponent == 0) return "1u";
+    string base = emit_primary(ctx, monomial->primary);
+    if (monomial->exponent == 1) return base;
+    return "wrap_pow(" + base + ", " + to_string(monomial->exponent) + "u)";
+}
+
+string emit_term(const emit_context_t& ctx, term_t* term) {
+    string code = to_string((unsigned int) term->coefficient) + "u";
+    for (monomial_t* monomial : term->monomial_list) {
+        code += " * " + emit_monomial(ctx, monomial);
+    }
+    return code;
+}
+
+string emit_term_list(const emit_context_t& ctx, term_list_t* term_list) {
+    string code = "(0u";
+    for (term_list_t* node = term_list; node != nullptr; node = node->next) {
+        code += (node->op == OP_MINUS) ? " - " : " + ";
+        code += emit_term(ctx, node->term);
+    }
+    return code + ")";
+}
+
+}  // namespace
+
+void Parser::emit_cpp(std::ostream& out) {
+    allocate_frame();
+    int slots = std::max(frame_size, 1);
+
+    // An argument that is never assigned is bound to location 0 by
+    // argument_id() when its statement runs; free variables with its name
+    // read 0 before that and location 0 after
+    std::set<std::string> free_names;
+    for (const auto& entry : poly_bodies) {
+        free_names.insert(entry.second->flat.free_vars.begin(), entry.second->flat.free_vars.end());
+    }
+    std::map<std::string, int> late_bound;
+    for (stmt_t* current = stmt_list_head; current != nullptr; current = current->next) {
+        if (current->type != STMT_ASSIGN) continue;
+        for (const std::string& actual : static_cast<poly_eval_t*>(current->eval)->args) {
+            if (!is_literal(actual) && free_names.count(actual) && !location_table.count(actual)) {
+                late_bound.insert({actual, (int) late_bound.size()});
+            }
+        }
+    }
+
+    out << "// Generated by --emit-cpp; build with: g++ -O3 -o program program.cc\n"
+        << "#include <cstdio>\n\n"
+        << "static unsigned int m[" << slots << "];\n\n"
+        << "static inline unsigned int wrap_pow(unsigned int base, unsigned int e) {\n"
+        << "    unsigned int result = 1;\n"
+        << "    while (e) {\n"
+        << "        if (e & 1) result *= base;\n"
+        << "        base *= base;\n"
+        << "        e >>= 1;\n"
+        << "    }\n"
+        << "    return result;\n"
+        << "}\n\n";
+    if (!late_bound.empty()) {
+        out << "// set when an argument binds a free variable to m[" << frame[0] << "]\n"
+            << "static bool bound[" << late_bound.size() << "];\n\n";
+    }
+
+    for (const auto& entry : poly_bodies) {
+        const std::vector<std::string>& params = poly_params[entry.first];
+        emit_context_t ctx = {&params, &location_table, &frame, &late_bound};
+        out << "static inline unsigned int poly_" << entry.first << "(";
+        for (size_t i = 0; i < params.size(); i++) {
+            out << (i ? ", " : "") << "unsigned int p" << i;
+        }
+        out << ") {\n"
+            << "    return " << emit_term_list(ctx, entry.second->terms) << ";\n"
+            << "}\n\n";
+    }
+
+    std::vector<bool> bound(late_bound.size(), false);
+    out << "int main() {\n";
+    for (size_t i = 0; i < input_vars_in_order.size(); ++i) {
+        out << "    m[" << frame_slot(input_vars_in_order[i]) << "] = "
+            << (unsigned int) input_value(i) << "u;\n";
+    }
+    for (stmt_t* current = stmt_list_head; current != nullptr; current = current->next) {
+        switch (current->type) {
+            case STMT_INPUT:
+                break;
+            case STMT_OUTPUT:
+                out << "    std::printf(\"%d\\n\", (int) m[" << frame[current->var] << "]);\n";
+                break;
+            case STMT_ASSIGN: {
+                poly_eval_t* eval = static_cast<poly_eval_t*>(current->eval);
+                if (poly_bodies.find(eval->name) == poly_bodies.end() ||
+                    poly_params[eval->name].size() != eval->args.size()) {
+                    std::cerr << "[fatal] cannot emit call to poly " << eval->name
+                              << " on line " << current->line_no << std::endl;
+                    throw parser_exit_t{1};
+                }
+                for (const std::string& actual : eval->args) {
+                    auto late = late_bound.find(actual);
+                    if (late != late_bound.end() && !bound[late->second]) {
+                        bound[late->second] = true;
+                        out << "    bound[" << late->second << "] = true;\n";
+                    }
+                }
+                out << "    m[" << frame[current->lhs] << "] = poly_" << eval->name << "(";
+                for (size_t i = 0; i < eval->args.size(); ++i) {
+                    const std::string& actual = eval->args[i];
+                    out << (i ? ", " : "");
+                    if (is_literal(actual)) {
+                        out << (unsigned int) std::stoi(actual) << "u";
+                    } else {
+                        out << "m[" << frame[argument_id(actual)] << "]";
+                    }
+                }
+                out << ");\n";
+                break;
+            }
+        }
+    }
+    out << "    return 0;\n"
+        << "}\n";
+}
@@ -0,0 +1,180 @@
+/*
+ * Lowered EXECUTE program.
+ *
+ * execute_program() does not walk the stmt_t list. lower_program() turns it
+ * into a contiguous instr_t array first: INPUT statements are dropped (their
+ * values are stored before the first statement runs), variable arguments
+ * become memory locations, constants are converted once, and each call
+ * refers to an exec_poly_t that already knows whether the polynomial has
+ * native code. run_program() runs the array with computed goto where the
+ * compiler supports it and a switch otherwise.
+ *
+ * An assignment whose outcome depends on run-time state (a wrong argument
+ * count, an argument that has never been assigned, a constant that does not
+ * fit in an int) is kept as INSTR_STMT and goes through execute_assign(), so
+ * it fails or binds at the same point it did before.
+ */
+#include <cctype>
+#include <stdexcept>
+
+#include "parser.h"
+
+using namespace std;
+
+#if defined(__GNUC__)
+#define EXEC_COMPUTED_GOTO 1
+#else
+#define EXEC_COMPUTED_GOTO 0
+#endif
+
+void Parser::lower_program() {
+    program.clear();
+    exec_args.clear();
+    exec_polys.clear();
+    unordered_map<string, unsigned int> poly_index;
+    for (stmt_t* stmt = stmt_list_head; stmt != nullptr; stmt = stmt->next) {
+        instr_t instr;
+        instr.line_no = stmt->line_no;
+        if (stmt->type == STMT_INPUT) continue;
+        if (stmt->type == STMT_OUTPUT) {
+            instr.kind = INSTR_OUTPUT;
+            instr.var = frame[stmt->var];
+        } else if (!lower_assign(stmt, instr, poly_index)) {
+            instr.kind = INSTR_STMT;
+            instr.stmt = stmt;
+        }
+        program.push_back(instr);
+    }
+    instr_t halt;
+    halt.kind = INSTR_HALT;
+    halt.line_no = 0;
+    program.push_back(halt);
+}
+
+bool Parser::lower_assign(stmt_t* stmt, instr_t& instr, unordered_map<string, unsigned int>& poly_index) {
+    poly_eval_t* eval = static_cast<poly_eval_t*>(stmt->eval);
+    auto index = poly_index.find(eval->name);
+    if (index == poly_index.end()) {
+        auto params = poly_params.find(eval->name);
+        auto body = poly_bodies.find(eval->name);
+        if (params == poly_params.end() || body == poly_bodies.end()) return false;
+        auto multiplications = poly_mult_count.find(eval->name);
+        exec_poly_t poly = {&body->first, &body->second->flat, params->second.size(), nullptr,
+                            (multiplications != poly_mult_count.end()) ? multiplications->second : 0};
+        if (use_jit) {
+            auto entry = jit_table.find(eval->name);
+            if (entry != jit_table.end()) poly.compiled = entry->second;
+        }
+        index = poly_index.insert({eval->name, (unsigned int) exec_polys.size()}).first;
+        exec_polys.push_back(poly);
+    }
+    if (exec_polys[index->second].param_count != eval->args.size()) return false;
+
+    size_t arg_begin = exec_args.size();
+    for (const string& actual : eval->args) {
+        instr_arg_t arg = {-1, 0};
+        if (is_literal(actual)) {
+            try {
+                arg.value = stoi(actual);
+            } catch (const logic_error&) {
+                exec_args.resize(arg_begin);
+                return false;
+            }
+        } else {
+            auto loc = location_table.find(actual);
+            if (loc == location_table.end()) {
+                exec_args.resize(arg_begin);
+                return false;
+            }
+            arg.slot = frame[loc->second];
+        }
+        exec_args.push_back(arg);
+    }
+
+    instr.kind = exec_polys[index->second].compiled ? INSTR_EVAL_JIT : INSTR_EVAL;
+    instr.eval.lhs = frame[stmt->lhs];
+    instr.eval.poly = index->second;
+    instr.eval.arg_begin = (unsigned int) arg_begin;
+    instr.eval.arg_count = (unsigned int) eval->args.size();
+    return true;
+}
+
+void Parser::run_program(OutputWriter& writer) {
+    // padded so the JIT can always be passed JIT_MAX_PARAMS values
+    size_t max_args = JIT_MAX_PARAMS;
+    for (const instr_t& instr : program) {
+        if (instr.kind == INSTR_EVAL || instr.kind == INSTR_EVAL_JIT) {
+            max_args = max(max_args, (size_t) instr.eval.arg_count);
+        }
+    }
+    vector<int> args(max_args, 0);
+    const instr_arg_t* arg_table = exec_args.data();
+    int* mem = memory.data();
+    const instr_t* ip = program.data();
+    const exec_poly_t* poly = nullptr;
+    unsigned long long start = 0;
+
+    auto load_args = [&] {
+        const instr_arg_t* arg = arg_table + ip->eval.arg_begin;
+        for (unsigned int i = 0; i < ip->eval.arg_count; i++) {
+            args[i] = (arg[i].slot >= 0) ? mem[arg[i].slot] : arg[i].value;
+        }
+        poly = &exec_polys[ip->eval.poly];
+        if (stats) {
+            stats->poly_evaluations++;
+            stats->multiplications += poly->multiplications;
+        }
+        if (profiler) start = Profiler::now();
+    };
+    auto finish_eval = [&] {
+        if (profiler) {
+            profiler->record(*poly->name, ip->line_no, poly->multiplications, Profiler::now() - start);
+        }
+    };
+
+#if EXEC_COMPUTED_GOTO
+    static void* const dispatch[] = {
+        &&target_INSTR_OUTPUT, &&target_INSTR_EVAL, &&target_INSTR_EVAL_JIT,
+        &&target_INSTR_STMT, &&target_INSTR_HALT,
+    };
+#define TARGET(kind) target_##kind:
+#define DISPATCH() goto *dispatch[ip->kind]
+    DISPATCH();
+    {
+#else
+#define TARGET(kind) case kind:
+#define DISPATCH() continue
+    while (true) switch (ip->kind) {
+#endif
+        TARGET(INSTR_OUTPUT) {
+            writer.write_int(mem[ip->var]);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(INSTR_EVAL) {
+            load_args();
+            mem[ip->eval.lhs] = evaluate_flat(*poly->flat, args.data());
+            finish_eval();
+            ip++;
+            DISPATCH();
+        }
+        TARGET(INSTR_EVAL_JIT) {
+            load_args();
+            const int* v = args.data();
+            mem[ip->eval.lhs] = poly->compiled(v[0], v[1], v[2], v[3], v[4], v[5]);
+            finish_eval();
+            ip++;
+            DISPATCH();
+        }
+        TARGET(INSTR_STMT) {
+            execute_assign(ip->stmt);
+            ip++;
+            DISPATCH();
+        }
+        TARGET(INSTR_HALT) {
+            return;
+        }
+    }
+#undef TARGET
+#undef DISPATCH
+}
@@ -0,0 +1,179 @@
+/*
+ * Polynomial expansion (--expand).
+ *
+ * Every body is multiplied out into a sum of monomials with coefficients
+ * modulo 2^32, so the expanded form evaluates to exactly what execute_program
+ * computes. Variables (parameters, then free variables) are packed into one
+ * Kronecker variable y: with syntactic degree bounds d_i, x_i becomes
+ * y^(prod_{j<i} (d_j + 1)). No sub-expression can exceed the degree bound of
+ * the whole body, so every product and power of the flat body is a single
+ * univariate poly_mul()/poly_pow() and nothing wraps into another
+ * variable's digits.
+ *
+ * Task 5 keeps reporting the syntactic degree: x^2 - x^2 expands to 0 but
+ * still has degree 2.
+ */
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "parser.h"
+#include "polyarith.h"
+
+using namespace std;
+
+namespace {
+
+const size_t MAX_EXPANDED_SIZE = (size_t) 1 << 22;
+
+struct kronecker_t {
+    vector<size_t> bound;       // degree bound + 1 per variable
+    vector<size_t> stride;
+    size_t size;
+};
+
+// Per-variable syntactic degrees of the whole body; false if the dense
+// layout would need more than MAX_EXPANDED_SIZE coefficients
+bool kronecker_layout(const flat_poly_t& flat, size_t params, kronecker_t& layout) {
+    size_t variables = params + flat.free_vars.size();
+    vector<vector<size_t>> list_degree(flat.list_end.size(), vector<size_t>(variables, 0));
+    vector<size_t> term_degree(variables);
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        for (; t < flat.list_end[k]; t++) {
+            fill(term_degree.begin(), term_degree.end(), 0);
+            for (; m < flat.term_end[t]; m++) {
+                size_t exponent = (size_t) (unsigned int) flat.exponent[m];
+                if (flat.operand_kind[m] == FLAT_LIST) {
+                    const vector<size_t>& nested = list_degree[flat.operand[m]];
+                    for (size_t v = 0; v < variables; v++) {
+                        if (nested[v] != 0 && exponent > MAX_EXPANDED_SIZE / nested[v]) return false;
+                        term_degree[v] += nested[v] * exponent;
+                    }
+                } else {
+                    size_t v = flat.operand[m] + (flat.operand_kind[m] == FLAT_FREE ? params : 0);
+                    term_degree[v] += exponent;
+                }
+                for (size_t v = 0; v < variables; v++) {
+                    if (term_degree[v] >= MAX_EXPANDED_SIZE) return false;
+                }
+            }
+            for (size_t v = 0; v < variables; v++) {
+                list_degree[k][v] = max(list_degree[k][v], term_degree[v]);
+            }
+        }
+    }
+
+    layout.bound.assign(variables, 1);
+    layout.stride.assign(variables, 1);
+    layout.size = 1;
+    for (size_t v = 0; v < variables; v++) {
+        layout.bound[v] = list_degree.back()[v] + 1;
+        layout.stride[v] = layout.size;
+        if (layout.bound[v] > MAX_EXPANDED_SIZE / layout.size) return false;
+        layout.size *= layout.bound[v];
+    }
+    return true;
+}
+
+dense_poly_t expand_flat(const flat_poly_t& flat, const kronecker_t& layout, size_t params) {
+    vector<dense_poly_t> list_values(flat.list_end.size());
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        dense_poly_t sum;
+        for (; t < flat.list_end[k]; t++) {
+            dense_poly_t product = {(uint32_t) flat.coefficient[t]};
+            for (; m < flat.term_end[t]; m++) {
+                unsigned int exponent = (unsigned int) flat.exponent[m];
+                if (exponent == 0 || product.empty()) continue;
+                if (flat.operand_kind[m] == FLAT_LIST) {
+                    product = poly_mul(product, poly_pow(list_values[flat.operand[m]], exponent));
+                } else {
+                    // a power of a single variable is a shift
+                    size_t v = flat.operand[m] + (flat.operand_kind[m] == FLAT_FREE ? params : 0);
+                    product.insert(product.begin(), (size_t) exponent * layout.stride[v], 0);
+                }
+            }
+            if (sum.size() < product.size()) sum.resize(product.size(), 0);
+            for (size_t i = 0; i < product.size(); i++) {
+                sum[i] = flat.negate[t] ? sum[i] - product[i] : sum[i] + product[i];
+            }
+        }
+        poly_trim(sum);
+        list_values[k] = std::move(sum);
+    }
+    return list_values.back();
+}
+
+struct expanded_term_t {
+    int coefficient;
+    size_t degree;
+    vector<size_t> exponents;
+};
+
+}  // namespace
+
+void Parser::expand_polys(std::ostream& out) {
+    for (const auto& entry : poly_bodies) {
+        const string& name = entry.first;
+        const flat_poly_t& flat = entry.second->flat;
+        const vector<string>& params = poly_params[name];
+
+        out << name << "(";
+        for (size_t i = 0; i < params.size(); i++) {
+            out << (i ? ", " : "") << params[i];
+        }
+        out << ") =";
+
+        kronecker_t layout;
+        if (!kronecker_layout(flat, params.size(), layout)) {
+            out << " too large to expand" << endl;
+            continue;
+        }
+        dense_poly_t expanded = expand_flat(flat, layout, params.size());
+
+        vector<expanded_term_t> terms;
+        for (size_t i = 0; i < expanded.size(); i++) {
+            if (expanded[i] == 0) continue;
+            expanded_term_t term = {(int) expanded[i], 0, vector<size_t>(layout.bound.size())};
+            for (size_t v = 0; v < layout.bound.size(); v++) {
+                term.exponents[v] = i / layout.stride[v] % layout.bound[v];
+                term.degree += term.exponents[v];
+            }
+            terms.push_back(term);
+        }
+        sort(terms.begin(), terms.end(), [](const expanded_term_t& a, const expanded_term_t& b) {
+            if (a.degree != b.degree) return a.degree > b.degree;
+            return a.exponents > b.exponents;
+        });
+
+        if (terms.empty()) out << " 0";
+        for (size_t i = 0; i < terms.size(); i++) {
+            long long coefficient = terms[i].coefficient;
+            bool negative = coefficient < 0;
+            if (negative) coefficient = -coefficient;
+            if (i == 0) {
+                out << (negative ? " -" : " ");
+            } else {
+                out << (negative ? " - " : " + ");
+            }
+            bool constant = (terms[i].degree == 0);
+            if (coefficient != 1 || constant) {
+                out << coefficient;
+            }
+            bool first_factor = (coefficient == 1 && !constant);
+            for (size_t v = 0; v < terms[i].exponents.size(); v++) {
+                size_t e = terms[i].exponents[v];
+                if (e == 0) continue;
+                out << (first_factor ? "" : " ");
+                out << (v < params.size() ? params[v] : flat.free_vars[v - params.size()]);
+                if (e > 1) out << "^" << e;
+                first_factor = false;
+            }
+        }
+        out << ";" << endl;
+    }
+}
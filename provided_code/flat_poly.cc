@@ -0,0 +1,200 @@
+/*
+ * Flat polynomial representation.
+ *
+ * parse_poly_body() flattens every body into a flat_poly_t with parameters
+ * resolved to argument indices. Execution, degree computation and the
+ * multiplication counts of --stats all run over these arrays instead of
+ * the linked AST. Arithmetic is unsigned so it wraps like the int
+ * evaluation it replaces.
+ */
+#include <algorithm>
+
+#include "parser.h"
+
+using namespace std;
+
+void Parser::flatten_poly(poly_body_t* body, const vector<string>& params) {
+    body->flat = flat_poly_t();
+    unordered_map<term_list_t*, unsigned int> flattened;
+    flatten_list(body->terms, params, body->flat, flattened);
+    build_wide_lists(body->flat);
+}
+
+// Returns the index of the list; nested lists are flattened first. A list
+// shared by several monomials of the DAG is flattened, and so evaluated,
+// once.
+unsigned int Parser::flatten_list(term_list_t* term_list, const vector<string>& params, flat_poly_t& flat,
+                                  unordered_map<term_list_t*, unsigned int>& flattened) {
+    auto done = flattened.find(term_list);
+    if (done != flattened.end()) return done->second;
+    vector<unsigned int> nested;
+    for (term_list_t* node = term_list; node != nullptr; node = node->next) {
+        for (monomial_t* monomial : node->term->monomial_list) {
+            if (monomial->primary != nullptr && monomial->primary->kind == TERM_LIST) {
+                nested.push_back(flatten_list(monomial->primary->term_list, params, flat, flattened));
+            }
+        }
+    }
+
+    size_t next_nested = 0;
+    for (term_list_t* node = term_list; node != nullptr; node = node->next) {
+        flat.coefficient.push_back(node->term->coefficient);
+        flat.negate.push_back(node->op == OP_MINUS);
+        for (monomial_t* monomial : node->term->monomial_list) {
+            primary_t* primary = monomial->primary;
+            flat.exponent.push_back(monomial->exponent);
+            if (primary != nullptr && primary->kind == TERM_LIST) {
+                flat.operand_kind.push_back(FLAT_LIST);
+                flat.operand.push_back(nested[next_nested++]);
+                continue;
+            }
+            const string& name = (primary != nullptr) ? primary->var_name : string();
+            int idx = param_index(params, name);
+            if (idx >= 0) {
+                flat.operand_kind.push_back(FLAT_PARAM);
+                flat.operand.push_back((unsigned int) idx);
+                continue;
+            }
+            auto free_var = find(flat.free_vars.begin(), flat.free_vars.end(), name);
+            flat.operand_kind.push_back(FLAT_FREE);
+            flat.operand.push_back((unsigned int) (free_var - flat.free_vars.begin()));
+            if (free_var == flat.free_vars.end()) {
+                flat.free_vars.push_back(name);
+            }
+        }
+        flat.term_end.push_back((unsigned int) flat.exponent.size());
+    }
+    flat.list_end.push_back((unsigned int) flat.coefficient.size());
+    flattened[term_list] = (unsigned int) flat.list_end.size() - 1;
+    return (unsigned int) flat.list_end.size() - 1;
+}
+
+// Variables that are not parameters read program memory by name
+void Parser::resolve_free_vars() {
+    for (auto& entry : poly_bodies) {
+        flat_poly_t& flat = entry.second->flat;
+        flat.free_slots.clear();
+        for (const string& name : flat.free_vars) {
+            auto loc = location_table.find(name);
+            flat.free_slots.push_back(loc != location_table.end() ? frame[loc->second] : -1);
+        }
+    }
+}
+
+static inline unsigned int wrap_pow(unsigned int base, unsigned int exponent) {
+    unsigned int result = 1;
+    while (exponent != 0) {
+        if (exponent & 1) result *= base;
+        exponent >>= 1;
+        base *= base;
+    }
+    return result;
+}
+
+int Parser::evaluate_flat(const flat_poly_t& flat, const int* args) {
+    list_values.resize(flat.list_end.size());
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        if (flat.wide_index[k] >= 0 && wide_kernel != WIDE_OFF) {
+            list_values[k] = evaluate_wide(flat, flat.wide[flat.wide_index[k]], args);
+            t = flat.list_end[k];
+            m = flat.term_end[t - 1];
+            continue;
+        }
+        unsigned int sum = 0;
+        for (; t < flat.list_end[k]; t++) {
+            unsigned int product = 1;
+            for (; m < flat.term_end[t]; m++) {
+                unsigned int base;
+                switch (flat.operand_kind[m]) {
+                    case FLAT_PARAM:
+                        base = (unsigned int) args[flat.operand[m]];
+                        break;
+                    case FLAT_FREE: {
+                        int slot = flat.free_slots[flat.operand[m]];
+                        base = (slot >= 0) ? (unsigned int) memory[slot] : 0;
+                        break;
+                    }
+                    default:
+                        base = list_values[flat.operand[m]];
+                        break;
+                }
+                product *= wrap_pow(base, (unsigned int) flat.exponent[m]);
+            }
+            product *= (unsigned int) flat.coefficient[t];
+            sum = flat.negate[t] ? sum - product : sum + product;
+        }
+        list_values[k] = sum;
+    }
+    return (int) list_values.back();
+}
+
+// Fills the power table of a wide list, then sums its terms in one kernel call
+unsigned int Parser::evaluate_wide(const flat_poly_t& flat, const wide_list_t& wide, const int* args) {
+    size_t entries = wide.base_exponent.size();
+    wide_table.resize(entries + 1);
+    wide_table[0] = 1;
+    for (size_t i = 0; i < entries; i++) {
+        unsigned int base;
+        switch (wide.base_kind[i]) {
+            case FLAT_PARAM:
+                base = (unsigned int) args[wide.base_operand[i]];
+                break;
+            case FLAT_FREE: {
+                int slot = flat.free_slots[wide.base_operand[i]];
+                base = (slot >= 0) ? (unsigned int) memory[slot] : 0;
+                break;
+            }
+            default:
+                base = list_values[wide.base_operand[i]];
+                break;
+        }
+        unsigned int exponent = wide.base_exponent[i];
+        bool same_base = i > 0 && wide.base_kind[i] == wide.base_kind[i - 1]
+                         && wide.base_operand[i] == wide.base_operand[i - 1];
+        wide_table[i + 1] = same_base ? wide_table[i] * wrap_pow(base, exponent - wide.base_exponent[i - 1])
+                                      : wrap_pow(base, exponent);
+    }
+    return wide_sum(wide, wide_table.data(), wide_kernel);
+}
+
+int Parser::get_degree(const flat_poly_t& flat) {
+    vector<int> list_degree(flat.list_end.size());
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        int degree = 0;
+        for (; t < flat.list_end[k]; t++) {
+            int term_degree = 0;
+            for (; m < flat.term_end[t]; m++) {
+                int base = (flat.operand_kind[m] == FLAT_LIST) ? list_degree[flat.operand[m]] : 1;
+                term_degree += base * flat.exponent[m];
+            }
+            degree = max(degree, term_degree);
+        }
+        list_degree[k] = degree;
+    }
+    return list_degree.back();
+}
+
+// Number of multiplications the tree walker performs for one evaluation
+long long Parser::count_multiplications(const flat_poly_t& flat) {
+    vector<long long> list_count(flat.list_end.size());
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        long long count = 0;
+        for (; t < flat.list_end[k]; t++) {
+            count += 1;  // coefficient * product
+            for (; m < flat.term_end[t]; m++) {
+                count += 1 + flat.exponent[m];
+                if (flat.operand_kind[m] == FLAT_LIST) {
+                    count += list_count[flat.operand[m]];
+                }
+            }
+        }
+        list_count[k] = count;
+    }
+    return list_count.back();
+}
@@ -0,0 +1,109 @@
+/*
+ * Execution frame allocation.
+ *
+ * The parser numbers variables in order of first appearance; those ids name
+ * variables in diagnostics (variable_names). At run time memory is indexed
+ * by frame slot instead. EXECUTE is straight-line code, so a variable is
+ * live from its first to its last appearance, and allocate_frame() gives
+ * variables whose ranges do not overlap the same slot (linear scan over the
+ * statement list).
+ *
+ * Some variables keep a slot of their own because their value is observed
+ * outside that range: one read before it is assigned must still read 0, a
+ * free variable of a polynomial body is read whenever that body runs, and
+ * id 0 is where arguments that are never assigned are bound at run time.
+ */
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <queue>
+
+#include "parser.h"
+
+using namespace std;
+
+void Parser::allocate_frame() {
+    size_t variables = variable_names.size();
+    vector<int> first(variables, -1);
+    vector<int> last(variables, -1);
+    vector<char> own_slot(variables, 0);
+    auto appear = [&](int id, int position, bool assigned) {
+        if (first[id] < 0) {
+            first[id] = position;
+            own_slot[id] = !assigned;
+        }
+        last[id] = position;
+    };
+
+    // INPUT values are stored before the first statement (position 0)
+    for (const string& name : input_vars_in_order) {
+        appear(location_table[name], 0, true);
+    }
+    int position = 0;
+    for (stmt_t* stmt = stmt_list_head; stmt != nullptr; stmt = stmt->next) {
+        position++;
+        if (stmt->type == STMT_INPUT) {
+            appear(stmt->var, position, true);
+        } else if (stmt->type == STMT_OUTPUT) {
+            appear(stmt->var, position, false);
+        } else {
+            // arguments are read before the result is stored, so the result
+            // may take the slot of an argument that dies here
+            poly_eval_t* eval = static_cast<poly_eval_t*>(stmt->eval);
+            for (const string& actual : eval->args) {
+                if (is_literal(actual)) continue;
+                auto loc = location_table.find(actual);
+                if (loc != location_table.end()) appear(loc->second, position, false);
+            }
+            appear(stmt->lhs, position, true);
+        }
+    }
+
+    if (variables > 0) own_slot[0] = 1;
+    for (const auto& entry : poly_bodies) {
+        for (const string& name : entry.second->flat.free_vars) {
+            auto loc = location_table.find(name);
+            if (loc != location_table.end()) own_slot[loc->second] = 1;
+        }
+    }
+
+    frame.assign(variables, -1);
+    frame_size = 0;
+    vector<int> order;
+    for (size_t id = 0; id < variables; id++) {
+        if (own_slot[id] || first[id] < 0) {
+            frame[id] = frame_size++;
+        } else {
+            order.push_back((int) id);
+        }
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return first[a] < first[b]; });
+
+    // (last appearance, slot) of the ranges still holding a slot
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> active;
+    vector<int> free_slots;
+    for (int id : order) {
+        while (!active.empty() && active.top().first <= first[id]) {
+            free_slots.push_back(active.top().second);
+            active.pop();
+        }
+        if (free_slots.empty()) {
+            frame[id] = frame_size++;
+        } else {
+            frame[id] = free_slots.back();
+            free_slots.pop_back();
+        }
+        active.push({last[id], frame[id]});
+    }
+
+    if (stats) {
+        stats->variables = (long long) variables;
+        stats->frame_slots = frame_size;
+    }
+}
+
+// Slot of a variable by name, -1 if the name is not a variable
+int Parser::frame_slot(const string& name) const {
+    auto loc = location_table.find(name);
+    return (loc != location_table.end()) ? frame[loc->second] : -1;
+}
@@ -0,0 +1,197 @@
+/*
+ * Incremental re-execution for parameter sweeps.
+ *
+ * The first execute_incremental() runs the lowered program and records,
+ * for every value an instruction reads (arguments, free variables of the
+ * body, the variable of an OUTPUT), whether it was a constant, an INPUTS
+ * value or the result of an earlier instruction. Memory slots are shared
+ * between variables (frame.cc), so dependencies are kept per instruction
+ * rather than per slot. The instructions that read a value are its users.
+ *
+ * A later call starts from the inputs that set_input() actually changed and
+ * re-evaluates their users in program order. Only a result that changed
+ * schedules its own users, so statements outside the affected cone keep
+ * their cached values and cost nothing. The output is written in full.
+ *
+ * Only int arithmetic is recorded. A program that keeps an INSTR_STMT
+ * (see exec_program.cc) binds or fails at run time, and is executed in
+ * full on every call, like any other arithmetic mode.
+ */
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "parser.h"
+
+using namespace std;
+
+void Parser::set_input(size_t index, int value) {
+    if (binary_inputs.is_open() && !inputs_edited) {
+        input_values.assign(binary_inputs.data(), binary_inputs.data() + binary_inputs.size());
+    }
+    inputs_edited = true;
+    if (index >= input_values.size()) input_values.resize(index + 1, 0);
+    input_values[index] = value;
+    edited_inputs.push_back(index);
+}
+
+void Parser::execute_incremental() {
+    incremental_evaluations = 0;
+    if (incremental_ready) {
+        OutputWriter writer(out, binary_output);
+        rerun_incremental(writer);
+        return;
+    }
+    edited_inputs.clear();
+    if (arith_mode != ARITH_INT) {
+        execute_program();
+        return;
+    }
+    prepare_execution();
+    input_counter = 0;
+    for (size_t i = 0; i < input_vars_in_order.size(); ++i) {
+        memory[frame_slot(input_vars_in_order[i])] = input_value(i);
+    }
+    lower_program();
+    OutputWriter writer(out, binary_output);
+    for (const instr_t& instr : program) {
+        if (instr.kind == INSTR_STMT) {
+            run_program(writer);
+            return;
+        }
+    }
+    record_incremental(writer);
+    incremental_ready = true;
+}
+
+int Parser::incr_source_value(const incr_source_t& source) const {
+    if (source.kind == INCR_INPUT) return incr_inputs[source.value];
+    if (source.kind == INCR_RESULT) return incr_value[source.value];
+    return source.value;
+}
+
+void Parser::record_incremental(OutputWriter& writer) {
+    size_t n = program.size();
+    incr_inputs.assign(input_vars_in_order.size(), 0);
+    // what each slot holds at the current point of the run
+    vector<incr_source_t> slot_source(frame_size, incr_source_t{INCR_CONST, 0});
+    for (size_t i = 0; i < input_vars_in_order.size(); ++i) {
+        incr_inputs[i] = input_value(i);
+        slot_source[frame_slot(input_vars_in_order[i])] = {INCR_INPUT, (int) i};
+    }
+    incr_input_users.assign(incr_inputs.size(), {});
+    incr_result_users.assign(n, {});
+    incr_value.assign(n, 0);
+    incr_source_begin.assign(n + 1, 0);
+    incr_sources.clear();
+    incr_outputs.clear();
+    incr_queued.assign(n, 0);
+
+    size_t max_args = JIT_MAX_PARAMS;
+    for (const instr_t& instr : program) {
+        if (instr.kind == INSTR_EVAL || instr.kind == INSTR_EVAL_JIT) {
+            max_args = max(max_args, (size_t) instr.eval.arg_count);
+        }
+    }
+    arg_buffer.assign(max_args, 0);
+
+    auto read = [&](unsigned int i, incr_source_t source) {
+        incr_sources.push_back(source);
+        vector<unsigned int>* users = nullptr;
+        if (source.kind == INCR_INPUT) users = &incr_input_users[source.value];
+        if (source.kind == INCR_RESULT) users = &incr_result_users[source.value];
+        if (users != nullptr && (users->empty() || users->back() != i)) users->push_back(i);
+        return incr_source_value(source);
+    };
+
+    for (unsigned int i = 0; i < n; i++) {
+        incr_source_begin[i] = (unsigned int) incr_sources.size();
+        const instr_t& instr = program[i];
+        if (instr.kind == INSTR_OUTPUT) {
+            incr_value[i] = read(i, slot_source[instr.var]);
+            incr_outputs.push_back(i);
+            writer.write_int(incr_value[i]);
+        } else if (instr.kind == INSTR_EVAL || instr.kind == INSTR_EVAL_JIT) {
+            const exec_poly_t& poly = exec_polys[instr.eval.poly];
+            const instr_arg_t* arg = &exec_args[instr.eval.arg_begin];
+            for (unsigned int a = 0; a < instr.eval.arg_count; a++) {
+                arg_buffer[a] = (arg[a].slot >= 0) ? read(i, slot_source[arg[a].slot])
+                                                   : read(i, {INCR_CONST, arg[a].value});
+            }
+            // memory follows the run, so the body sees its free variables
+            for (int slot : poly.flat->free_slots) {
+                read(i, (slot >= 0) ? slot_source[slot] : incr_source_t{INCR_CONST, 0});
+            }
+            const int* v = arg_buffer.data();
+            int value = poly.compiled ? poly.compiled(v[0], v[1], v[2], v[3], v[4], v[5])
+                                      : evaluate_flat(*poly.flat, v);
+            if (stats) {
+                stats->poly_evaluations++;
+                stats->multiplications += poly.multiplications;
+            }
+            incremental_evaluations++;
+            memory[instr.eval.lhs] = value;
+            incr_value[i] = value;
+            slot_source[instr.eval.lhs] = {INCR_RESULT, (int) i};
+        }
+    }
+    incr_source_begin[n] = (unsigned int) incr_sources.size();
+}
+
+void Parser::rerun_incremental(OutputWriter& writer) {
+    // users always come after what they read, so the smallest pending
+    // index has nothing pending before it
+    priority_queue<unsigned int, vector<unsigned int>, greater<unsigned int>> pending;
+    auto schedule = [&](const vector<unsigned int>& users) {
+        for (unsigned int u : users) {
+            if (incr_queued[u]) continue;
+            incr_queued[u] = 1;
+            pending.push(u);
+        }
+    };
+    for (size_t k : edited_inputs) {
+        if (k >= incr_inputs.size()) continue;
+        int value = input_value(k);
+        if (value == incr_inputs[k]) continue;
+        incr_inputs[k] = value;
+        schedule(incr_input_users[k]);
+    }
+    edited_inputs.clear();
+
+    while (!pending.empty()) {
+        unsigned int i = pending.top();
+        pending.pop();
+        incr_queued[i] = 0;
+        const instr_t& instr = program[i];
+        const incr_source_t* source = &incr_sources[incr_source_begin[i]];
+        if (instr.kind == INSTR_OUTPUT) {
+            incr_value[i] = incr_source_value(source[0]);
+            continue;
+        }
+        const exec_poly_t& poly = exec_polys[instr.eval.poly];
+        unsigned int arg_count = instr.eval.arg_count;
+        for (unsigned int a = 0; a < arg_count; a++) {
+            arg_buffer[a] = incr_source_value(source[a]);
+        }
+        const vector<int>& free_slots = poly.flat->free_slots;
+        for (size_t f = 0; f < free_slots.size(); f++) {
+            if (free_slots[f] >= 0) memory[free_slots[f]] = incr_source_value(source[arg_count + f]);
+        }
+        const int* v = arg_buffer.data();
+        int value = poly.compiled ? poly.compiled(v[0], v[1], v[2], v[3], v[4], v[5])
+                                  : evaluate_flat(*poly.flat, v);
+        if (stats) {
+            stats->poly_evaluations++;
+            stats->multiplications += poly.multiplications;
+        }
+        incremental_evaluations++;
+        if (value != incr_value[i]) {
+            incr_value[i] = value;
+            schedule(incr_result_users[i]);
+        }
+    }
+
+    for (unsigned int i : incr_outputs) {
+        writer.write_int(incr_value[i]);
+    }
+}
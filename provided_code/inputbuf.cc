@@ -7,7 +7,9 @@
 #include <istream>
 #include <vector>
 #include <string>
+#include <cctype>
 #include <cstdio>
+#include <iterator>
 
 #include "inputbuf.h"
 
@@ -18,7 +20,7 @@ bool InputBuffer::EndOfInput()
     if (!input_buffer.empty())
         return false;
     else
-        return cin.eof();
+        return in->eof();
 }
 
 char InputBuffer::UngetChar(char c)
@@ -34,7 +36,7 @@ void InputBuffer::GetChar(char& c)
         c = input_buffer.back();
         input_buffer.pop_back();
     } else {
-        cin.get(c);
+        in->get(c);
     }
 }
 
@@ -44,3 +46,31 @@ string InputBuffer::UngetString(string s)
         input_buffer.push_back(s[s.size()-i-1]);
     return s;
 }
+
+// Returns everything that has not been read yet, including pushed back
+// characters, and leaves the buffer at end of input
+string InputBuffer::ReadAll()
+{
+    string s(input_buffer.rbegin(), input_buffer.rend());
+    input_buffer.clear();
+    s.append(istreambuf_iterator<char>(*in), istreambuf_iterator<char>());
+    in->setstate(ios::eofbit);
+    return s;
+}
+
+string InputBuffer::ReadChunk(size_t size)
+{
+    string s(input_buffer.rbegin(), input_buffer.rend());
+    input_buffer.clear();
+    if (s.size() < size) {
+        size_t have = s.size();
+        s.resize(size);
+        in->read(&s[have], size - have);
+        s.resize(have + in->gcount());
+    }
+    char c;
+    while ((s.empty() || !isspace((unsigned char) s.back())) && in->get(c)) {
+        s += c;
+    }
+    return s;
+}
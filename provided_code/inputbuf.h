@@ -6,17 +6,26 @@
 #ifndef __INPUT_BUFFER__H__
 #define __INPUT_BUFFER__H__
 
+#include <iostream>
 #include <string>
 #include <vector>
 
 class InputBuffer {
   public:
+    InputBuffer() : in(&std::cin) {}
+    explicit InputBuffer(std::istream& in) : in(&in) {}
+
     void GetChar(char&);
     char UngetChar(char);
     std::string UngetString(std::string);
     bool EndOfInput();
+    std::string ReadAll();
+    // At least size characters, or the rest of the input, extended through
+    // the next whitespace character so that no token is cut in two
+    std::string ReadChunk(size_t size);
 
   private:
+    std::istream* in;
     std::vector<char> input_buffer;
 };
 
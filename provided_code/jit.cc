@@ -0,0 +1,239 @@
+/*
+ * Native code tier for polynomial evaluation.
+ *
+ * Parameters are read straight from the argument registers and every level
+ * of nesting keeps its partial sum or product in a register of its own, so
+ * the generated code never touches memory. Bodies nested deeper than the
+ * available registers are left to the interpreter. Arithmetic is 32-bit and
+ * wraps exactly like the int evaluation in parser.cc.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "jit.h"
+#include "parser.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+using namespace std;
+
+namespace {
+
+// x86-64 register numbers
+const int RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, RDI = 7;
+const int R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15;
+
+// Parameters stay in the registers they arrive in
+const int PARAM_REGS[JIT_MAX_PARAMS] = {RDI, RSI, RDX, RCX, R8, R9};
+
+// Intermediate values, one register per nesting level; the result is left
+// in the first. The last five are callee-saved and only pushed when used.
+const int TEMP_REGS[] = {RAX, R10, R11, RBX, R12, R13, R14, R15};
+const int TEMP_COUNT = sizeof(TEMP_REGS) / sizeof(TEMP_REGS[0]);
+const int FIRST_SAVED_TEMP = 3;
+
+struct code_buffer_t {
+    vector<unsigned char> bytes;
+    const vector<string>* params;
+    int temps_used = 1;
+    bool ok = true;
+
+    void emit(std::initializer_list<unsigned char> b) {
+        bytes.insert(bytes.end(), b.begin(), b.end());
+    }
+    void emit32(int32_t v) {
+        uint32_t u = (uint32_t) v;
+        for (int i = 0; i < 4; i++) {
+            bytes.push_back((unsigned char) (u >> (8 * i)));
+        }
+    }
+    void rex(int reg, int rm) {
+        if (reg >= 8 || rm >= 8) bytes.push_back((unsigned char) (0x40 | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0)));
+    }
+    void modrm(int reg, int rm) {
+        bytes.push_back((unsigned char) (0xC0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+    // op r/m32, r32 (mov 0x89, add 0x01, sub 0x29, xor 0x31)
+    void op_rr(unsigned char op, int dst, int src) {
+        rex(src, dst);
+        bytes.push_back(op);
+        modrm(src, dst);
+    }
+    void mov(int dst, int src) { if (dst != src) op_rr(0x89, dst, src); }
+    void add(int dst, int src) { op_rr(0x01, dst, src); }
+    void sub(int dst, int src) { op_rr(0x29, dst, src); }
+    void imul(int dst, int src) {                      // imul r32, r/m32
+        rex(dst, src);
+        emit({0x0F, 0xAF});
+        modrm(dst, src);
+    }
+    void mov_imm(int dst, int32_t v) {
+        if (v == 0) {
+            op_rr(0x31, dst, dst);                     // xor dst, dst
+            return;
+        }
+        rex(0, dst);
+        bytes.push_back((unsigned char) (0xB8 + (dst & 7)));
+        emit32(v);
+    }
+    void push(int reg) { rex(0, reg); bytes.push_back((unsigned char) (0x50 + (reg & 7))); }
+    void pop(int reg) { rex(0, reg); bytes.push_back((unsigned char) (0x58 + (reg & 7))); }
+
+    // Register holding nesting level t, or -1 once they run out
+    int temp(int t) {
+        if (t >= TEMP_COUNT) {
+            ok = false;
+            return -1;
+        }
+        temps_used = max(temps_used, t + 1);
+        return TEMP_REGS[t];
+    }
+};
+
+void gen_term_list(code_buffer_t& code, term_list_t* term_list, int t);
+
+// Register that holds the parameter named by primary, or -1
+int param_reg(code_buffer_t& code, primary_t* primary) {
+    if (primary->kind != VAR) return -1;
+    int idx = param_index(*code.params, primary->var_name);
+    if (idx < 0) {
+        // free variables read interpreter memory; leave them to the tree walker
+        code.ok = false;
+        return -1;
+    }
+    return PARAM_REGS[idx];
+}
+
+// Leaves the value of the monomial in temp(t)
+void gen_monomial(code_buffer_t& code, monomial_t* monomial, int t) {
+    int dst = code.temp(t);
+    if (!code.ok) return;
+    unsigned int e = (unsigned int) monomial->exponent;
+    if (e == 0) {
+        code.mov_imm(dst, 1);
+        return;
+    }
+    int base = param_reg(code, monomial->primary);
+    if (!code.ok) return;
+    if (base < 0) {
+        gen_term_list(code, monomial->primary->term_list, t);
+        if (!code.ok || e == 1) return;
+        base = code.temp(t + 1);
+        if (!code.ok) return;
+        code.mov(base, dst);
+    } else {
+        code.mov(dst, base);
+    }
+
+    // square-and-multiply over the bits of the constant exponent
+    int top = 31;
+    while (!(e & (1u << top))) top--;
+    for (int bit = top - 1; bit >= 0; --bit) {
+        code.imul(dst, dst);
+        if (e & (1u << bit)) {
+            code.imul(dst, base);
+        }
+    }
+}
+
+// Leaves the value of the term in temp(t)
+void gen_term(code_buffer_t& code, term_t* term, int t) {
+    int dst = code.temp(t);
+    if (!code.ok) return;
+    code.mov_imm(dst, term->coefficient);
+    for (monomial_t* monomial : term->monomial_list) {
+        int reg = (monomial->exponent == 1) ? param_reg(code, monomial->primary) : -1;
+        if (!code.ok) return;
+        if (reg < 0) {
+            gen_monomial(code, monomial, t + 1);
+            reg = code.temp(t + 1);
+            if (!code.ok) return;
+        }
+        code.imul(dst, reg);
+    }
+}
+
+// Leaves the value of the term list in temp(t)
+void gen_term_list(code_buffer_t& code, term_list_t* term_list, int t) {
+    int dst = code.temp(t);
+    if (!code.ok) return;
+    term_list_t* node = term_list;
+    if (node->op == OP_MINUS) {
+        code.mov_imm(dst, 0);
+    } else {
+        gen_term(code, node->term, t);
+        node = node->next;
+    }
+    for (; node != nullptr && code.ok; node = node->next) {
+        gen_term(code, node->term, t + 1);
+        int src = code.temp(t + 1);
+        if (!code.ok) return;
+        if (node->op == OP_MINUS) {
+            code.sub(dst, src);
+        } else {
+            code.add(dst, src);
+        }
+    }
+}
+
+}  // namespace
+
+bool PolyJit::available() {
+    return JIT_SUPPORTED;
+}
+
+PolyJit::~PolyJit() {
+#if JIT_SUPPORTED
+    for (const auto& region : regions) {
+        munmap(region.first, region.second);
+    }
+#endif
+}
+
+jit_fn_t PolyJit::compile(poly_body_t* body, const vector<string>& params) {
+#if JIT_SUPPORTED
+    if (body == nullptr || params.size() > JIT_MAX_PARAMS) return nullptr;
+
+    code_buffer_t code;
+    code.params = &params;
+    gen_term_list(code, body->terms, 0);
+    if (!code.ok) return nullptr;
+
+    // callee-saved temporaries are pushed around the body
+    vector<unsigned char> body_bytes;
+    body_bytes.swap(code.bytes);
+    for (int t = FIRST_SAVED_TEMP; t < code.temps_used; t++) {
+        code.push(TEMP_REGS[t]);
+    }
+    code.bytes.insert(code.bytes.end(), body_bytes.begin(), body_bytes.end());
+    for (int t = code.temps_used - 1; t >= FIRST_SAVED_TEMP; t--) {
+        code.pop(TEMP_REGS[t]);
+    }
+    code.emit({0xC3});                                     // ret
+
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t size = (code.bytes.size() + page - 1) / page * page;
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return nullptr;
+    memcpy(mem, code.bytes.data(), code.bytes.size());
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return nullptr;
+    }
+    regions.push_back({mem, size});
+    return (jit_fn_t) mem;
+#else
+    (void) body;
+    (void) params;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,38 @@
+/*
+ * Native code tier for polynomial evaluation.
+ *
+ * Each polynomial body is translated into x86-64 machine code placed in
+ * mmap'd executable memory. Callers keep the tree walker as a fallback:
+ * compile() returns nullptr whenever a body cannot be compiled.
+ */
+#ifndef __JIT_H__
+#define __JIT_H__
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct poly_body_t;
+
+// Parameter values are passed in the System V argument registers
+// (edi, esi, edx, ecx, r8d, r9d), so at most JIT_MAX_PARAMS are supported.
+// Unused trailing arguments are ignored by the generated code.
+#define JIT_MAX_PARAMS 6
+typedef int (*jit_fn_t)(int, int, int, int, int, int);
+
+class PolyJit {
+  public:
+    PolyJit() = default;
+    PolyJit(const PolyJit&) = delete;
+    PolyJit& operator=(const PolyJit&) = delete;
+    ~PolyJit();
+
+    static bool available();
+    jit_fn_t compile(poly_body_t* body, const std::vector<std::string>& params);
+
+  private:
+    std::vector<std::pair<void*, size_t>> regions;
+};
+
+#endif  //__JIT_H__
@@ -7,7 +7,12 @@
 #include <istream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstdint>
+#include <thread>
+#include <utility>
 
 #include "lexer.h"
 #include "inputbuf.h"
@@ -33,123 +38,191 @@ void Token::Print()
 // internal vector. This faciliates the implementation of peek()
 LexicalAnalyzer::LexicalAnalyzer()
 {
-    this->line_no = 1;
-    tmp.lexeme = "";
-    tmp.line_no = 1;
-    tmp.token_type = ERROR;
-
-    Token token = GetTokenMain();
-    index = 0;
-
-    while (token.token_type != END_OF_FILE)
-    {
-        tokenList.push_back(token);     // push token into internal list
-        token = GetTokenMain();        // and get next token from standatd input
-    }
-    // pushes END_OF_FILE is not pushed on the token list
+    Tokenize();
+}
 
+LexicalAnalyzer::LexicalAnalyzer(std::istream& in) : input(in)
+{
+    Tokenize();
 }
 
-bool LexicalAnalyzer::SkipSpace()
+LexicalAnalyzer::LexicalAnalyzer(std::istream& in, int threads) : LexicalAnalyzer(in, threads, false)
 {
-    char c;
-    bool space_encountered = false;
+}
 
-    input.GetChar(c);
-    line_no += (c == '\n');
+// Single-producer single-consumer ring between the scanning thread and the
+// consumer. Slots are published by advancing tail and released by advancing
+// head; a side that finds the ring full or empty yields its time slice.
+struct TokenPipe {
+    static const size_t CAPACITY = 4096;
 
-    while (!input.EndOfInput() && isspace(c)) {
-        space_encountered = true;
-        input.GetChar(c);
-        line_no += (c == '\n');
+    LexicalAnalyzer scanner;
+    std::vector<Token> ring;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<bool> done;
+    std::atomic<bool> stop;
+    std::thread producer;
+
+    explicit TokenPipe(std::istream& in)
+        : scanner(std::vector<Token>()), ring(CAPACITY), head(0), tail(0), done(false), stop(false)
+    {
+        scanner.input = InputBuffer(in);
+        producer = thread([this] { Run(); });
     }
 
-    if (!input.EndOfInput()) {
-        input.UngetChar(c);
+    ~TokenPipe()
+    {
+        stop.store(true, memory_order_relaxed);
+        producer.join();
     }
-    return space_encountered;
-}
 
-bool LexicalAnalyzer::IsKeyword(string s)
-{
-    for (int i = 0; i < KEYWORDS_COUNT; i++) {
-        if (s == keyword[i]) {
-            return true;
+    void Run()
+    {
+        scanner.StartScan();
+        Token token = scanner.GetTokenMain();
+        size_t t = 0;
+        while (token.token_type != END_OF_FILE) {
+            while (t - head.load(memory_order_acquire) == CAPACITY) {
+                if (stop.load(memory_order_relaxed)) return;
+                this_thread::yield();
+            }
+            ring[t % CAPACITY] = std::move(token);
+            tail.store(++t, memory_order_release);
+            token = scanner.GetTokenMain();
         }
+        done.store(true, memory_order_release);
     }
-    return false;
-}
+};
 
-TokenType LexicalAnalyzer::FindKeywordIndex(string s)
+LexicalAnalyzer::LexicalAnalyzer(std::istream& in, int threads, bool pipelined) : input(in)
 {
-    for (int i = 0; i < KEYWORDS_COUNT; i++) {
-        if (s == keyword[i]) {
-            return (TokenType) (i + 1);
-        }
+    if (pipelined) {
+        line_no = 1;
+        index = 0;
+        pipe.reset(new TokenPipe(in));
+    } else if (threads <= 1) {
+        Tokenize();
+    } else {
+        TokenizeParallel(threads);
     }
-    return ERROR;
 }
 
-Token LexicalAnalyzer::ScanNumber()
+LexicalAnalyzer::LexicalAnalyzer(std::vector<Token> tokens) : tokenList(std::move(tokens))
 {
-    char c;
+    line_no = tokenList.empty() ? 1 : tokenList.back().line_no;
+    index = 0;
+}
 
-    input.GetChar(c);
-    if (isdigit(c)) {
-        if (c == '0') {
-            tmp.lexeme = "0";
-        } else {
-            tmp.lexeme = "";
-            while (!input.EndOfInput() && isdigit(c)) {
-                tmp.lexeme += c;
-                input.GetChar(c);
-            }
-            if (!input.EndOfInput()) {
-                input.UngetChar(c);
+LexicalAnalyzer::LexicalAnalyzer(LexicalAnalyzer&&) = default;
+LexicalAnalyzer& LexicalAnalyzer::operator=(LexicalAnalyzer&&) = default;
+LexicalAnalyzer::~LexicalAnalyzer() = default;
+
+// Moves tokens out of the pipe until tokenList holds count of them or the
+// input is exhausted
+void LexicalAnalyzer::Receive(size_t count)
+{
+    size_t h = pipe->head.load(memory_order_relaxed);
+    while (tokenList.size() < count) {
+        bool done = pipe->done.load(memory_order_acquire);
+        size_t t = pipe->tail.load(memory_order_acquire);
+        if (h == t) {
+            if (done) {
+                line_no = pipe->scanner.line_no;
+                pipe.reset();
+                return;
             }
+            this_thread::yield();
+            continue;
         }
-        tmp.token_type = NUM;
-        tmp.line_no = line_no;
-        return tmp;
-    } else {
-        if (!input.EndOfInput()) {
-            input.UngetChar(c);
+        for (; h != t; h++) {
+            tokenList.push_back(std::move(pipe->ring[h % TokenPipe::CAPACITY]));
         }
-        tmp.lexeme = "";
-        tmp.token_type = ERROR;
-        tmp.line_no = line_no;
-        return tmp;
+        pipe->head.store(h, memory_order_release);
     }
 }
 
+vector<Token>& LexicalAnalyzer::tokens()
+{
+    if (pipe) Receive(SIZE_MAX);
+    return tokenList;
+}
+
+void LexicalAnalyzer::StartScan()
+{
+    this->line_no = 1;
+    text.clear();
+    text_pos = 0;
+}
+
+void LexicalAnalyzer::Tokenize()
+{
+    StartScan();
+
+    Token token = GetTokenMain();
+    index = 0;
+
+    while (token.token_type != END_OF_FILE)
+    {
+        tokenList.push_back(token);     // push token into internal list
+        token = GetTokenMain();        // and get next token from standatd input
+    }
+    // pushes END_OF_FILE is not pushed on the token list
 
-Token LexicalAnalyzer::ScanIdOrKeyword()
+}
+
+// Scans the token that starts at text[i], after any whitespace, without
+// reading past end; newlines that are skipped are added to line. Returns
+// the position just after the token, which is END_OF_FILE at end.
+static size_t ScanToken(const string& text, size_t i, size_t end, int& line, Token& token)
 {
-    char c;
-    input.GetChar(c);
+    while (i < end && isspace((unsigned char) text[i])) {
+        line += (text[i] == '\n');
+        i++;
+    }
+    token.lexeme = "";
+    token.line_no = line;
+    if (i == end) {
+        token.token_type = END_OF_FILE;
+        return i;
+    }
 
-    if (isalpha(c)) {
-        tmp.lexeme = "";
-        while (!input.EndOfInput() && isalnum(c)) {
-            tmp.lexeme += c;
-            input.GetChar(c);
+    char c = text[i];
+    switch (c) {
+        case ';': token.token_type = SEMICOLON; return i + 1;
+        case '^': token.token_type = POWER;     return i + 1;
+        case '-': token.token_type = MINUS;     return i + 1;
+        case '+': token.token_type = PLUS;      return i + 1;
+        case '=': token.token_type = EQUAL;     return i + 1;
+        case '(': token.token_type = LPAREN;    return i + 1;
+        case ')': token.token_type = RPAREN;    return i + 1;
+        case ',': token.token_type = COMMA;     return i + 1;
+        default:
+            break;
+    }
+
+    size_t start = i++;
+    if (isdigit((unsigned char) c)) {
+        // a leading 0 is a number on its own
+        if (c != '0') {
+            while (i < end && isdigit((unsigned char) text[i])) i++;
         }
-        if (!input.EndOfInput()) {
-            input.UngetChar(c);
+        token.lexeme.assign(text, start, i - start);
+        token.token_type = NUM;
+    } else if (isalpha((unsigned char) c)) {
+        while (i < end && isalnum((unsigned char) text[i])) i++;
+        token.lexeme.assign(text, start, i - start);
+        token.token_type = ID;
+        for (int k = 0; k < KEYWORDS_COUNT; k++) {
+            if (token.lexeme == keyword[k]) {
+                token.token_type = (TokenType) (k + 1);
+                break;
+            }
         }
-        tmp.line_no = line_no;
-        if (IsKeyword(tmp.lexeme))
-            tmp.token_type = FindKeywordIndex(tmp.lexeme);
-        else
-            tmp.token_type = ID;
     } else {
-        if (!input.EndOfInput()) {
-            input.UngetChar(c);
-        }
-        tmp.lexeme = "";
-        tmp.token_type = ERROR;
+        token.token_type = ERROR;
     }
-    return tmp;
+    return i;
 }
 
 // GetToken() accesses tokens from the tokenList that is populated when a 
@@ -157,6 +230,9 @@ Token LexicalAnalyzer::ScanIdOrKeyword()
 Token LexicalAnalyzer::GetToken()
 {
     Token token;
+    if (pipe && (size_t) index >= tokenList.size()) {
+        Receive(index + 1);
+    }
     if (index == tokenList.size()){       // return end of file if
         token.lexeme = "";                // index is too large
         token.line_no = line_no;
@@ -180,6 +256,9 @@ Token LexicalAnalyzer::peek(int howFar)
     } 
 
     int peekIndex = index + howFar - 1;
+    if (pipe && peekIndex >= (int) tokenList.size()) {
+        Receive(peekIndex + 1);
+    }
     if (peekIndex > (tokenList.size()-1)) { // if peeking too far
         Token token;                        // return END_OF_FILE
         token.lexeme = "";
@@ -190,40 +269,92 @@ Token LexicalAnalyzer::peek(int howFar)
         return tokenList[peekIndex];
 }
 
+// Input is read in chunks that end in whitespace, so a token never
+// continues into the next chunk
 Token LexicalAnalyzer::GetTokenMain()
 {
-    char c;
+    Token token;
+    while (true) {
+        text_pos = ScanToken(text, text_pos, text.size(), line_no, token);
+        if (token.token_type != END_OF_FILE) {
+            return token;
+        }
+        text = input.ReadChunk(1 << 16);
+        text_pos = 0;
+        if (text.empty()) {
+            return token;
+        }
+    }
+}
+
+// Tokenizes text[begin, end) with the scanner GetTokenMain() uses. Line
+// numbers are relative to the start of the chunk; the number of newlines seen is
+// returned so the caller can stitch chunks together.
+static int TokenizeChunk(const string& text, size_t begin, size_t end, vector<Token>& tokens)
+{
+    int line = 1;
+    Token token;
+    size_t i = ScanToken(text, begin, end, line, token);
+    while (token.token_type != END_OF_FILE) {
+        tokens.push_back(token);
+        i = ScanToken(text, i, end, line, token);
+    }
+    return line - 1;
+}
 
-    SkipSpace();
-    tmp.lexeme = "";
-    tmp.line_no = line_no;
-    tmp.token_type = END_OF_FILE;
-    if (!input.EndOfInput())
-        input.GetChar(c);
-    else
-        return tmp;
+void LexicalAnalyzer::TokenizeParallel(int threads)
+{
+    string text = input.ReadAll();
 
-    switch (c) {
-        case ';': tmp.token_type = SEMICOLON; return tmp;
-        case '^': tmp.token_type = POWER;     return tmp;
-        case '-': tmp.token_type = MINUS;     return tmp;
-        case '+': tmp.token_type = PLUS;      return tmp;
-        case '=': tmp.token_type = EQUAL;     return tmp;
-        case '(': tmp.token_type = LPAREN;    return tmp;
-        case ')': tmp.token_type = RPAREN;    return tmp;
-        case ',': tmp.token_type = COMMA;     return tmp;
-        default:
-            if (isdigit(c)) {
-                input.UngetChar(c);
-                return ScanNumber();
-            } else if (isalpha(c)) {
-                input.UngetChar(c);
-                return ScanIdOrKeyword();
-            } else if (input.EndOfInput())
-                tmp.token_type = END_OF_FILE;
-            else
-                tmp.token_type = ERROR;
-            
-            return tmp;
+    // Every token ends at whitespace, so chunks are cut just after a
+    // whitespace character
+    vector<size_t> bounds = {0};
+    for (int k = 1; k < threads; k++) {
+        size_t cut = max(text.size() * k / threads, bounds.back());
+        while (cut < text.size() && !isspace(text[cut])) cut++;
+        if (cut >= text.size()) break;
+        bounds.push_back(cut + 1);
     }
+    bounds.push_back(text.size());
+
+    size_t chunks = bounds.size() - 1;
+    vector<vector<Token>> chunk_tokens(chunks);
+    vector<int> newlines(chunks);
+    vector<thread> workers;
+    for (size_t k = 0; k < chunks; k++) {
+        workers.emplace_back([&, k] {
+            newlines[k] = TokenizeChunk(text, bounds[k], bounds[k + 1], chunk_tokens[k]);
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // Prefix sums of the newline counts give each chunk's first line
+    vector<int> first_line(chunks);
+    vector<size_t> first_token(chunks);
+    line_no = 1;
+    size_t total = 0;
+    for (size_t k = 0; k < chunks; k++) {
+        first_line[k] = line_no;
+        first_token[k] = total;
+        line_no += newlines[k];
+        total += chunk_tokens[k].size();
+    }
+
+    tokenList.resize(total);
+    workers.clear();
+    for (size_t k = 0; k < chunks; k++) {
+        workers.emplace_back([&, k] {
+            Token* dst = &tokenList[first_token[k]];
+            for (Token& token : chunk_tokens[k]) {
+                token.line_no += first_line[k] - 1;
+                *dst++ = std::move(token);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    index = 0;
 }
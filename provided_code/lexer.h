@@ -6,6 +6,7 @@
 #ifndef __LEXER__H__
 #define __LEXER__H__
 
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -29,25 +30,48 @@ class Token {
     int line_no;
 };
 
+struct TokenPipe;
+
 class LexicalAnalyzer {
   public:
     Token GetToken();
     Token peek(int);
     LexicalAnalyzer();
+    explicit LexicalAnalyzer(std::istream& in);
+    // Reads all of in and tokenizes it in up to threads chunks concurrently;
+    // the tokens are the same as the single-threaded constructor produces
+    LexicalAnalyzer(std::istream& in, int threads);
+    // With pipelined set, in is tokenized on a background thread and the
+    // tokens are handed over through a bounded queue as they are scanned;
+    // GetToken() and peek() wait for tokens that have not arrived yet
+    LexicalAnalyzer(std::istream& in, int threads, bool pipelined);
+    // Serves an already tokenized range; used to parse POLY chunks in parallel
+    explicit LexicalAnalyzer(std::vector<Token> tokens);
+    LexicalAnalyzer(LexicalAnalyzer&&);
+    LexicalAnalyzer& operator=(LexicalAnalyzer&&);
+    ~LexicalAnalyzer();
+    // In pipelined mode this counts the tokens received so far
+    size_t token_count() const { return tokenList.size(); }
+    size_t position() const { return index; }
+    void seek(size_t position) { index = (int) position; }
+    // Waits for the rest of the input in pipelined mode
+    std::vector<Token>& tokens();
 
   private:
+    friend struct TokenPipe;
+
     std::vector<Token> tokenList;
+    std::unique_ptr<TokenPipe> pipe;
+    void StartScan();
+    void Tokenize();
+    void TokenizeParallel(int threads);
+    void Receive(size_t count);
     Token GetTokenMain();
     int line_no;
     int index;
-    Token tmp;
     InputBuffer input;
-
-    bool SkipSpace();
-    bool IsKeyword(std::string);
-    TokenType FindKeywordIndex(std::string);
-    Token ScanNumber();
-    Token ScanIdOrKeyword();
+    std::string text;       // the chunk of input GetTokenMain() is scanning
+    size_t text_pos = 0;
 };
 
 #endif  //__LEXER__H__
@@ -0,0 +1,76 @@
+/*
+ * INPUTS values read from a binary file of 32-bit little-endian integers.
+ */
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_inputs.h"
+
+using namespace std;
+
+// An empty file maps to this so is_open() still holds
+static const int NO_VALUES[1] = {0};
+
+MappedInputs::~MappedInputs()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+bool MappedInputs::open(const string& path, string& error)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        error = path + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t) st.st_size;
+    if (size % sizeof(int32_t) != 0) {
+        error = path + ": size is not a multiple of 4 bytes";
+        close(fd);
+        return false;
+    }
+    if (size == 0) {
+        close(fd);
+        values = NO_VALUES;
+        count = 0;
+        return true;
+    }
+
+    void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    madvise(p, size, MADV_SEQUENTIAL);
+    mapping = p;
+    mapping_size = size;
+    count = size / sizeof(int32_t);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    const unsigned char* bytes = static_cast<const unsigned char*>(p);
+    swapped.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char* b = bytes + 4 * i;
+        swapped[i] = (int) ((uint32_t) b[0] | ((uint32_t) b[1] << 8) |
+                            ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24));
+    }
+    values = swapped.data();
+#else
+    values = static_cast<const int*>(p);
+#endif
+    return true;
+}
@@ -0,0 +1,34 @@
+/*
+ * INPUTS values read from a binary file of 32-bit little-endian integers.
+ *
+ * The file is mmap'd and used in place as the input array, so values are
+ * never parsed. On big-endian hosts the values are byte-swapped into a copy.
+ */
+#ifndef __MAPPED_INPUTS_H__
+#define __MAPPED_INPUTS_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class MappedInputs {
+  public:
+    MappedInputs() = default;
+    MappedInputs(const MappedInputs&) = delete;
+    MappedInputs& operator=(const MappedInputs&) = delete;
+    ~MappedInputs();
+
+    bool open(const std::string& path, std::string& error);
+    bool is_open() const { return values != nullptr; }
+    const int* data() const { return values; }
+    size_t size() const { return count; }
+
+  private:
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    std::vector<int> swapped;
+    const int* values = nullptr;
+    size_t count = 0;
+};
+
+#endif  //__MAPPED_INPUTS_H__
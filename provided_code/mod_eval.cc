@@ -0,0 +1,187 @@
+/*
+ * Modular evaluation (--mod P).
+ *
+ * All arithmetic is done modulo an odd prime P with Montgomery
+ * multiplication; values stay in Montgomery form until they are printed.
+ * evaluate_poly_mod_batch() evaluates one polynomial over many argument
+ * sets at once, with every operation an inner loop over the lanes, or by
+ * multipoint evaluation (multipoint.cc) when that is cheaper.
+ */
+#include <cctype>
+#include <cmath>
+#include <iostream>
+
+#include "parser.h"
+
+using namespace std;
+
+static const size_t MULTIPOINT_MIN_POINTS = 1024;
+static const size_t MULTIPOINT_MIN_DEGREE = 64;
+static const size_t MULTIPOINT_MAX_DEGREE = 1 << 20;
+static const double MULTIPOINT_COST_FACTOR = 16;    // measured, in direct multiplications
+
+// Montgomery multiplications per point for the lane loop: one per term and
+// a square-and-multiply per power
+static double direct_cost(const flat_poly_t& flat) {
+    double cost = (double) flat.coefficient.size();
+    for (int exponent : flat.exponent) {
+        for (unsigned int e = (unsigned int) exponent; e > 1; e >>= 1) cost += 2;
+    }
+    return cost;
+}
+
+// Per point, a group of about `degree` points costs a Karatsuba product
+// (degree^1.58) at each of log2(degree) tree levels
+static double multipoint_cost(size_t degree) {
+    double levels = 0;
+    for (size_t d = degree; d > 1; d >>= 1) levels++;
+    return MULTIPOINT_COST_FACTOR * pow((double) degree, 0.58) * levels;
+}
+
+uint64_t Parser::mod_eval(term_list_t* term_list, const vector<string>& params, const uint64_t* args) {
+    uint64_t sum = 0;
+    for (term_list_t* node = term_list; node != nullptr; node = node->next) {
+        uint64_t product = mont.from_signed(node->term->coefficient);
+        for (monomial_t* monomial : node->term->monomial_list) {
+            primary_t* primary = monomial->primary;
+            uint64_t base = 0;
+            if (primary->kind == TERM_LIST) {
+                base = mod_eval(primary->term_list, params, args);
+            } else {
+                int idx = param_index(params, primary->var_name);
+                if (idx >= 0) {
+                    base = args[idx];
+                } else if (location_table.count(primary->var_name)) {
+                    base = mod_memory[frame_slot(primary->var_name)];
+                }
+            }
+            product = mont.mul(product, mont.pow(base, (uint64_t) monomial->exponent));
+        }
+        sum = (node->op == OP_MINUS) ? mont.sub(sum, product) : mont.add(sum, product);
+    }
+    return sum;
+}
+
+void Parser::execute_program_mod() {
+    mod_memory.assign(memory.size(), 0);
+    for (size_t i = 0; i < input_vars_in_order.size(); ++i) {
+        mod_memory[frame_slot(input_vars_in_order[i])] = mont.from_signed(input_value(i));
+    }
+
+    OutputWriter writer(out, false);
+    std::vector<uint64_t> args;
+    for (stmt_t* current = stmt_list_head; current != nullptr; current = current->next) {
+        if (current->type == STMT_OUTPUT) {
+            writer.write_uint64(mont.from_mont(mod_memory[frame[current->var]]));
+            continue;
+        }
+        if (current->type != STMT_ASSIGN) continue;
+
+        poly_eval_t* eval = static_cast<poly_eval_t*>(current->eval);
+        const std::vector<std::string>& params = poly_params[eval->name];
+        if (params.size() != eval->args.size()) {
+            std::cerr << "[fatal] wrong number of arguments for poly " << eval->name << std::endl;
+            throw parser_exit_t{1};
+        }
+        if (stats) {
+            stats->poly_evaluations++;
+            stats->multiplications += poly_mult_count[eval->name];
+        }
+        args.resize(eval->args.size());
+        for (size_t i = 0; i < eval->args.size(); ++i) {
+            const std::string& actual = eval->args[i];
+            if (is_literal(actual)) {
+                args[i] = mont.from_signed(std::stoll(actual));
+            } else {
+                args[i] = mod_memory[frame[argument_id(actual)]];
+            }
+        }
+        unsigned long long start = profiler ? Profiler::now() : 0;
+        mod_memory[frame[current->lhs]] = mod_eval(poly_bodies[eval->name]->terms, params, args.data());
+        if (profiler) {
+            profiler->record(eval->name, current->line_no, poly_mult_count[eval->name], Profiler::now() - start);
+        }
+    }
+}
+
+// Lane-parallel form of mod_eval: args[p] holds parameter p for every lane
+void Parser::mod_eval_batch(term_list_t* term_list, const vector<string>& params,
+                            const vector<vector<uint64_t>>& args, size_t lanes, vector<uint64_t>& result) {
+    result.assign(lanes, 0);
+    vector<uint64_t> product(lanes);
+    vector<uint64_t> base(lanes);
+    for (term_list_t* node = term_list; node != nullptr; node = node->next) {
+        uint64_t coefficient = mont.from_signed(node->term->coefficient);
+        for (size_t l = 0; l < lanes; l++) {
+            product[l] = coefficient;
+        }
+        for (monomial_t* monomial : node->term->monomial_list) {
+            primary_t* primary = monomial->primary;
+            const uint64_t* values;
+            int idx = (primary->kind == VAR) ? param_index(params, primary->var_name) : -1;
+            if (primary->kind == TERM_LIST) {
+                mod_eval_batch(primary->term_list, params, args, lanes, base);
+                values = base.data();
+            } else if (idx >= 0) {
+                values = args[idx].data();
+            } else {
+                uint64_t free_value = location_table.count(primary->var_name) && !mod_memory.empty()
+                                          ? mod_memory[frame_slot(primary->var_name)] : 0;
+                for (size_t l = 0; l < lanes; l++) {
+                    base[l] = free_value;
+                }
+                values = base.data();
+            }
+            uint64_t exponent = (uint64_t) monomial->exponent;
+            for (size_t l = 0; l < lanes; l++) {
+                product[l] = mont.mul(product[l], mont.pow(values[l], exponent));
+            }
+        }
+        if (node->op == OP_MINUS) {
+            for (size_t l = 0; l < lanes; l++) {
+                result[l] = mont.sub(result[l], product[l]);
+            }
+        } else {
+            for (size_t l = 0; l < lanes; l++) {
+                result[l] = mont.add(result[l], product[l]);
+            }
+        }
+    }
+}
+
+std::vector<uint64_t> Parser::evaluate_poly_mod_batch(const std::string& poly_name,
+                                                      const std::vector<std::vector<long long>>& args) {
+    const std::vector<std::string>& params = poly_params[poly_name];
+    if (poly_bodies.count(poly_name) == 0 || params.size() != args.size()) {
+        std::cerr << "[fatal] wrong number of arguments for poly " << poly_name << std::endl;
+        throw parser_exit_t{1};
+    }
+    size_t lanes = args.empty() ? 0 : args[0].size();
+    for (const std::vector<long long>& column : args) {
+        if (column.size() != lanes) {
+            std::cerr << "[fatal] batch arguments for poly " << poly_name << " differ in length" << std::endl;
+            throw parser_exit_t{1};
+        }
+    }
+    std::vector<std::vector<uint64_t>> mont_args(args.size(), std::vector<uint64_t>(lanes));
+    for (size_t p = 0; p < args.size(); p++) {
+        for (size_t l = 0; l < lanes; l++) {
+            mont_args[p][l] = mont.from_signed(args[p][l]);
+        }
+    }
+    std::vector<uint64_t> result;
+    const flat_poly_t& flat = poly_bodies[poly_name]->flat;
+    std::vector<uint64_t> coefficients;
+    if (use_multipoint && params.size() == 1 && lanes >= MULTIPOINT_MIN_POINTS
+        && (size_t) get_degree(flat) >= MULTIPOINT_MIN_DEGREE
+        && direct_cost(flat) > multipoint_cost((size_t) get_degree(flat))
+        && expand_mod(flat, MULTIPOINT_MAX_DEGREE, coefficients)) {
+        multipoint_eval(coefficients, mont_args[0], result);
+    } else {
+        mod_eval_batch(poly_bodies[poly_name]->terms, params, mont_args, lanes, result);
+    }
+    for (uint64_t& value : result) {
+        value = mont.from_mont(value);
+    }
+    return result;
+}
@@ -0,0 +1,54 @@
+/*
+ * Arithmetic modulo an odd 64-bit modulus (--mod P).
+ */
+#include "modarith.h"
+
+Montgomery::Montgomery(uint64_t modulus) : n(modulus)
+{
+    // Newton iteration: each step doubles the number of correct low bits
+    uint64_t inv = n;
+    for (int i = 0; i < 6; i++) {
+        inv *= 2 - n * inv;
+    }
+    n_inv = inv;
+    r1 = (uint64_t) (((unsigned __int128) 1 << 64) % n);
+    r2 = (uint64_t) (((unsigned __int128) r1 * r1) % n);
+}
+
+bool is_prime_u64(uint64_t n)
+{
+    if (n < 2) return false;
+    static const uint64_t small_primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    for (uint64_t p : small_primes) {
+        if (n % p == 0) return n == p;
+    }
+
+    uint64_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) {
+        d >>= 1;
+        s++;
+    }
+
+    Montgomery mont(n);
+    uint64_t minus_one = mont.to_mont(n - 1);
+    for (uint64_t a : small_primes) {
+        uint64_t x = mont.pow(mont.to_mont(a), d);
+        if (x == mont.one() || x == minus_one) continue;
+        bool composite = true;
+        for (int r = 1; r < s; r++) {
+            x = mont.mul(x, x);
+            if (x == minus_one) {
+                composite = false;
+                break;
+            }
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+bool is_mod_modulus(uint64_t n)
+{
+    return n >= 3 && (n & 1) && is_prime_u64(n);
+}
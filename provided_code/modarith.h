@@ -0,0 +1,69 @@
+/*
+ * Arithmetic modulo an odd 64-bit modulus using Montgomery multiplication,
+ * for --mod P. Values handed to mul/add/sub/pow are in Montgomery form;
+ * convert with to_mont/from_mont at the boundaries.
+ */
+#ifndef __MODARITH_H__
+#define __MODARITH_H__
+
+#include <cstdint>
+
+class Montgomery {
+  public:
+    Montgomery() : Montgomery(3) {}
+    explicit Montgomery(uint64_t modulus);
+
+    uint64_t modulus() const { return n; }
+    uint64_t one() const { return r1; }
+
+    uint64_t to_mont(uint64_t a) const { return mul(a % n, r2); }
+    uint64_t from_mont(uint64_t a) const { return reduce(a); }
+    // Reduces a signed value into [0, n) before converting
+    uint64_t from_signed(long long a) const {
+        uint64_t u = (a < 0) ? n - ((0ull - (uint64_t) a) % n) : (uint64_t) a;
+        return to_mont(u == n ? 0 : u);
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const {
+        return reduce((unsigned __int128) a * b);
+    }
+    uint64_t add(uint64_t a, uint64_t b) const {
+        uint64_t s = a + b;
+        return (s < a || s >= n) ? s - n : s;
+    }
+    uint64_t sub(uint64_t a, uint64_t b) const {
+        return (a >= b) ? a - b : a + (n - b);
+    }
+    uint64_t pow(uint64_t base, uint64_t exponent) const {
+        uint64_t result = r1;
+        while (exponent != 0) {
+            if (exponent & 1) result = mul(result, base);
+            exponent >>= 1;
+            if (exponent != 0) base = mul(base, base);
+        }
+        return result;
+    }
+
+  private:
+    uint64_t n;
+    uint64_t n_inv;   // n^-1 mod 2^64
+    uint64_t r1;      // 2^64 mod n
+    uint64_t r2;      // 2^128 mod n
+
+    // REDC without the 2^64 + n overflow of the textbook form, valid for any odd n
+    uint64_t reduce(unsigned __int128 t) const {
+        uint64_t m = (uint64_t) t * n_inv;
+        uint64_t mn_high = (uint64_t) (((unsigned __int128) m * n) >> 64);
+        uint64_t t_high = (uint64_t) (t >> 64);
+        return (t_high >= mn_high) ? t_high - mn_high : t_high + (n - mn_high);
+    }
+};
+
+// Deterministic Miller-Rabin for 64-bit n
+bool is_prime_u64(uint64_t n);
+
+// Whether --mod accepts n: Montgomery form needs it odd, and inverses
+// (multipoint.cc) need it prime
+bool is_mod_modulus(uint64_t n);
+
+#endif  //__MODARITH_H__
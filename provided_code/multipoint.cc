@@ -0,0 +1,207 @@
+/*
+ * Multipoint evaluation modulo P.
+ *
+ * evaluate_poly_mod_batch() comes here for a single-parameter polynomial
+ * of large degree evaluated at many points. The body is expanded into its
+ * coefficients modulo P, the points are arranged in a subproduct tree (each
+ * node is the product of (x - a) over the points below it), and the
+ * polynomial is reduced modulo the nodes from the root down; the remainder
+ * at a node over a single point a is f(a). Products use Karatsuba from
+ * polyarith.h over Montgomery arithmetic. Remainders use Newton iteration
+ * for the inverse of the reversed divisor. Small nodes fall back to long
+ * division, and the last few points of each branch are evaluated by Horner.
+ */
+#include <algorithm>
+
+#include "parser.h"
+#include "polyarith.h"
+
+using namespace std;
+
+namespace {
+
+const size_t HORNER_BLOCK = 32;             // points evaluated directly at the bottom
+const size_t NEWTON_DIVISION_CUTOFF = 64;    // divisor degree
+
+typedef vector<uint64_t> mod_poly_t;        // Montgomery form, coefficient i of x^i
+
+struct mont_ring_t {
+    typedef uint64_t value_t;
+    const Montgomery* mont;
+    uint64_t zero() const { return 0; }
+    uint64_t add(uint64_t a, uint64_t b) const { return mont->add(a, b); }
+    uint64_t sub(uint64_t a, uint64_t b) const { return mont->sub(a, b); }
+    uint64_t mul(uint64_t a, uint64_t b) const { return mont->mul(a, b); }
+};
+
+void trim(mod_poly_t& a) {
+    while (!a.empty() && a.back() == 0) a.pop_back();
+}
+
+mod_poly_t mul(const mont_ring_t& ring, const mod_poly_t& a, const mod_poly_t& b) {
+    if (a.empty() || b.empty()) return mod_poly_t();
+    mod_poly_t result(a.size() + b.size() - 1, 0);
+    karatsuba_mul_add(ring, a.data(), a.size(), b.data(), b.size(), result.data());
+    return result;
+}
+
+mod_poly_t power(const mont_ring_t& ring, mod_poly_t base, uint64_t exponent) {
+    mod_poly_t result = {ring.mont->one()};
+    while (exponent != 0) {
+        if (exponent & 1) result = mul(ring, result, base);
+        exponent >>= 1;
+        if (exponent != 0) base = mul(ring, base, base);
+    }
+    return result;
+}
+
+// First n terms of 1 / a as a power series; a[0] must be invertible
+mod_poly_t series_inverse(const mont_ring_t& ring, const mod_poly_t& a, size_t n) {
+    const Montgomery& mont = *ring.mont;
+    uint64_t two = mont.add(mont.one(), mont.one());
+    mod_poly_t g = {mont.pow(a[0], mont.modulus() - 2)};
+    size_t k = 1;
+    while (k < n) {
+        // g <- g (2 - a g) doubles the number of correct terms
+        k = min(2 * k, n);
+        mod_poly_t a_low(a.begin(), a.begin() + min(a.size(), k));
+        mod_poly_t e = mul(ring, a_low, g);
+        e.resize(k, 0);
+        for (uint64_t& c : e) c = mont.sub(0, c);
+        e[0] = mont.add(e[0], two);
+        g = mul(ring, g, e);
+        g.resize(k, 0);
+    }
+    return g;
+}
+
+// a mod b for monic b
+mod_poly_t remainder(const mont_ring_t& ring, mod_poly_t a, const mod_poly_t& b) {
+    const Montgomery& mont = *ring.mont;
+    trim(a);
+    size_t m = b.size() - 1;
+    if (a.size() <= m) return a;
+    size_t quotient_size = a.size() - m;
+
+    if (m < NEWTON_DIVISION_CUTOFF) {
+        for (size_t i = a.size(); i-- > m;) {
+            uint64_t q = a[i];
+            if (q == 0) continue;
+            for (size_t j = 0; j <= m; j++) {
+                a[i - m + j] = mont.sub(a[i - m + j], mont.mul(q, b[j]));
+            }
+        }
+        a.resize(m);
+        return a;
+    }
+
+    // rev(q) = rev(a) / rev(b) mod x^quotient_size
+    mod_poly_t rev_a(a.rbegin(), a.rbegin() + quotient_size);
+    mod_poly_t rev_b(b.rbegin(), b.rend());
+    mod_poly_t rev_q = mul(ring, rev_a, series_inverse(ring, rev_b, quotient_size));
+    rev_q.resize(quotient_size, 0);
+    mod_poly_t q(rev_q.rbegin(), rev_q.rend());
+    mod_poly_t bq = mul(ring, b, q);
+    a.resize(m);
+    for (size_t i = 0; i < m; i++) {
+        a[i] = mont.sub(a[i], bq[i]);
+    }
+    return a;
+}
+
+}  // namespace
+
+// Coefficients of a single-parameter body modulo P; free variables are
+// constants read from mod_memory, as in mod_eval_batch()
+bool Parser::expand_mod(const flat_poly_t& flat, size_t max_degree, vector<uint64_t>& coefficients) {
+    if ((size_t) get_degree(flat) > max_degree) return false;
+    mont_ring_t ring = {&mont};
+    vector<mod_poly_t> list_values(flat.list_end.size());
+    unsigned int t = 0;
+    unsigned int m = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        mod_poly_t sum;
+        for (; t < flat.list_end[k]; t++) {
+            mod_poly_t product = {mont.from_signed(flat.coefficient[t])};
+            for (; m < flat.term_end[t]; m++) {
+                uint64_t exponent = (uint64_t) flat.exponent[m];
+                if (flat.operand_kind[m] == FLAT_LIST) {
+                    product = mul(ring, product, power(ring, list_values[flat.operand[m]], exponent));
+                } else if (flat.operand_kind[m] == FLAT_PARAM) {
+                    product.insert(product.begin(), (size_t) exponent, 0);
+                } else {
+                    auto loc = location_table.find(flat.free_vars[flat.operand[m]]);
+                    uint64_t value = (loc != location_table.end() && !mod_memory.empty()) ? mod_memory[frame[loc->second]] : 0;
+                    uint64_t factor = mont.pow(value, exponent);
+                    for (uint64_t& c : product) c = mont.mul(c, factor);
+                }
+            }
+            if (sum.size() < product.size()) sum.resize(product.size(), 0);
+            for (size_t i = 0; i < product.size(); i++) {
+                sum[i] = flat.negate[t] ? mont.sub(sum[i], product[i]) : mont.add(sum[i], product[i]);
+            }
+        }
+        trim(sum);
+        list_values[k] = std::move(sum);
+    }
+    coefficients = std::move(list_values.back());
+    return true;
+}
+
+// f at points[begin, end), all in Montgomery form
+void Parser::multipoint_eval_group(const vector<uint64_t>& f, const vector<uint64_t>& points,
+                                   size_t begin, size_t end, vector<uint64_t>& result) {
+    mont_ring_t ring = {&mont};
+
+    // tree[0] holds one node per block of HORNER_BLOCK points; node j of
+    // level l covers blocks [j 2^l, (j + 1) 2^l)
+    vector<vector<mod_poly_t>> tree(1);
+    for (size_t block = begin; block < end; block += HORNER_BLOCK) {
+        mod_poly_t node = {mont.one()};
+        for (size_t i = block; i < min(end, block + HORNER_BLOCK); i++) {
+            node = mul(ring, node, mod_poly_t{mont.sub(0, points[i]), mont.one()});
+        }
+        tree[0].push_back(std::move(node));
+    }
+    while (tree.back().size() > 1) {
+        const vector<mod_poly_t>& below = tree.back();
+        vector<mod_poly_t> level;
+        for (size_t j = 0; j < below.size(); j += 2) {
+            level.push_back(j + 1 < below.size() ? mul(ring, below[j], below[j + 1]) : below[j]);
+        }
+        tree.push_back(std::move(level));
+    }
+
+    vector<mod_poly_t> remainders = {remainder(ring, f, tree.back()[0])};
+    for (size_t l = tree.size() - 1; l-- > 0;) {
+        vector<mod_poly_t> next(tree[l].size());
+        for (size_t j = 0; j < tree[l].size(); j++) {
+            next[j] = remainder(ring, remainders[j / 2], tree[l][j]);
+        }
+        remainders.swap(next);
+    }
+
+    for (size_t block = 0; block < remainders.size(); block++) {
+        const mod_poly_t& r = remainders[block];
+        size_t first = begin + block * HORNER_BLOCK;
+        for (size_t i = first; i < min(end, first + HORNER_BLOCK); i++) {
+            uint64_t value = 0;
+            for (size_t c = r.size(); c-- > 0;) {
+                value = mont.add(mont.mul(value, points[i]), r[c]);
+            }
+            result[i] = value;
+        }
+    }
+}
+
+// f at every point. Points are taken in groups of about deg f, so a tree
+// is never much taller than the polynomial it reduces.
+void Parser::multipoint_eval(const vector<uint64_t>& f, const vector<uint64_t>& points, vector<uint64_t>& result) {
+    result.assign(points.size(), 0);
+    if (f.empty()) return;
+    size_t group = HORNER_BLOCK;
+    while (group < f.size()) group *= 2;
+    for (size_t begin = 0; begin < points.size(); begin += group) {
+        multipoint_eval_group(f, points, begin, min(points.size(), begin + group), result);
+    }
+}
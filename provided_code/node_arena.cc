@@ -0,0 +1,95 @@
+/*
+ * Hash-consing tables of NodeArena. The tables hold pointers into the
+ * arena and hash the pointed-to fields, so a candidate node on the stack
+ * can be looked up without allocating it.
+ */
+#include <functional>
+#include <unordered_set>
+
+#include "node_arena.h"
+#include "parser.h"
+
+using namespace std;
+
+namespace {
+
+inline size_t mix(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+struct node_hash_t {
+    size_t operator()(const primary_t* p) const {
+        return mix(mix(p->kind, hash<const void*>()(p->term_list)), hash<string>()(p->var_name));
+    }
+    size_t operator()(const monomial_t* m) const {
+        return mix(hash<const void*>()(m->primary), (size_t) m->exponent);
+    }
+    size_t operator()(const term_t* t) const {
+        size_t h = (size_t) t->coefficient;
+        for (const monomial_t* m : t->monomial_list) h = mix(h, hash<const void*>()(m));
+        return h;
+    }
+    size_t operator()(const term_list_t* l) const {
+        return mix(mix(hash<const void*>()(l->term), l->op), hash<const void*>()(l->next));
+    }
+};
+
+struct node_equal_t {
+    bool operator()(const primary_t* a, const primary_t* b) const {
+        return a->kind == b->kind && a->term_list == b->term_list && a->var_name == b->var_name;
+    }
+    bool operator()(const monomial_t* a, const monomial_t* b) const {
+        return a->primary == b->primary && a->exponent == b->exponent;
+    }
+    bool operator()(const term_t* a, const term_t* b) const {
+        return a->coefficient == b->coefficient && a->monomial_list == b->monomial_list;
+    }
+    bool operator()(const term_list_t* a, const term_list_t* b) const {
+        return a->term == b->term && a->op == b->op && a->next == b->next;
+    }
+};
+
+}  // namespace
+
+struct NodeArena::tables_t {
+    unordered_set<primary_t*, node_hash_t, node_equal_t> primaries;
+    unordered_set<monomial_t*, node_hash_t, node_equal_t> monomials;
+    unordered_set<term_t*, node_hash_t, node_equal_t> terms;
+    unordered_set<term_list_t*, node_hash_t, node_equal_t> term_lists;
+};
+
+NodeArena::NodeArena() : tables(new tables_t()) {}
+
+NodeArena::~NodeArena() = default;
+
+// Returns the arena's copy of node, allocating one the first time
+template <typename T, typename Table, typename Node>
+static T* intern_node(NodeArena& arena, Table& table, Node&& node, long long& unique) {
+    auto found = table.find(const_cast<T*>(&node));
+    if (found != table.end()) return *found;
+    T* copy = arena.make<T>();
+    *copy = std::forward<Node>(node);
+    table.insert(copy);
+    unique++;
+    return copy;
+}
+
+primary_t* NodeArena::intern(primary_t&& node) {
+    requested++;
+    return intern_node<primary_t>(*this, tables->primaries, std::move(node), unique);
+}
+
+monomial_t* NodeArena::intern(const monomial_t& node) {
+    requested++;
+    return intern_node<monomial_t>(*this, tables->monomials, node, unique);
+}
+
+term_t* NodeArena::intern(term_t&& node) {
+    requested++;
+    return intern_node<term_t>(*this, tables->terms, std::move(node), unique);
+}
+
+term_list_t* NodeArena::intern(const term_list_t& node) {
+    requested++;
+    return intern_node<term_list_t>(*this, tables->term_lists, node, unique);
+}
@@ -0,0 +1,44 @@
+/*
+ * Arena with hash-consed polynomial nodes.
+ *
+ * The parser builds each primary, monomial, term and term list node on the
+ * stack and interns it here. Children are interned first, so two nodes are
+ * structurally equal exactly when their fields (child pointers included)
+ * are equal, and a repeated sub-expression such as (x + 1) or x^2 becomes
+ * one shared node. Polynomial bodies are therefore DAGs. Sharing never
+ * crosses arenas, so an arena can still be dropped as a unit (see the
+ * per-declaration arenas of reparse.cc).
+ */
+#ifndef __NODE_ARENA_H__
+#define __NODE_ARENA_H__
+
+#include <memory>
+
+#include "arena.h"
+
+struct primary_t;
+struct monomial_t;
+struct term_t;
+struct term_list_t;
+
+class NodeArena : public Arena {
+  public:
+    NodeArena();
+    ~NodeArena();
+
+    primary_t* intern(primary_t&& node);
+    monomial_t* intern(const monomial_t& node);
+    term_t* intern(term_t&& node);
+    term_list_t* intern(const term_list_t& node);
+
+    long long interned_nodes() const { return requested; }
+    long long unique_nodes() const { return unique; }
+
+  private:
+    struct tables_t;
+    std::unique_ptr<tables_t> tables;
+    long long requested = 0;
+    long long unique = 0;
+};
+
+#endif  //__NODE_ARENA_H__
@@ -0,0 +1,92 @@
+/*
+ * Buffered writer for the values printed by OUTPUT statements.
+ */
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+#include "output_writer.h"
+
+using namespace std;
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+OutputWriter::OutputWriter(ostream* out, bool binary)
+    : out(out), binary(binary), buffer(BUFFER_SIZE)
+{
+}
+
+OutputWriter::~OutputWriter()
+{
+    flush();
+}
+
+// Formats value into dst two digits at a time; returns the length written.
+size_t OutputWriter::format_uint(unsigned long long u, char* dst)
+{
+    char tmp[MAX_VALUE_BYTES];
+    char* end = tmp + sizeof(tmp);
+    char* p = end;
+    while (u >= 100) {
+        unsigned int pair = (unsigned int) (u % 100) * 2;
+        u /= 100;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+    if (u >= 10) {
+        *--p = DIGIT_PAIRS[u * 2 + 1];
+        *--p = DIGIT_PAIRS[u * 2];
+    } else {
+        *--p = (char) ('0' + u);
+    }
+    size_t len = (size_t) (end - p);
+    memcpy(dst, p, len);
+    return len;
+}
+
+size_t OutputWriter::format_int(long long value, char* dst)
+{
+    if (value >= 0) {
+        return format_uint((unsigned long long) value, dst);
+    }
+    *dst = '-';
+    return 1 + format_uint(0ull - (unsigned long long) value, dst + 1);
+}
+
+void OutputWriter::write_line(const string& text)
+{
+    if (used + text.size() + 1 > buffer.size()) flush();
+    if (text.size() + 1 > buffer.size()) {
+        buffer.resize(text.size() + 1);
+    }
+    memcpy(&buffer[used], text.data(), text.size());
+    used += text.size();
+    buffer[used++] = '\n';
+}
+
+void OutputWriter::flush()
+{
+    if (used == 0) return;
+    if (out == &cout) {
+        // keep ordering with anything already written through std::cout
+        cout.flush();
+        const char* p = buffer.data();
+        size_t left = used;
+        while (left > 0) {
+            ssize_t n = ::write(STDOUT_FILENO, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            p += n;
+            left -= (size_t) n;
+        }
+    } else {
+        out->write(buffer.data(), (streamsize) used);
+    }
+    used = 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * Buffered writer for the values printed by OUTPUT statements.
+ *
+ * Values are formatted into a large buffer without iostreams and flushed
+ * with a single write() when the buffer fills or the writer is destroyed.
+ * In binary mode each value is written as a raw 32-bit little-endian
+ * integer instead of a line of text.
+ */
+#ifndef __OUTPUT_WRITER_H__
+#define __OUTPUT_WRITER_H__
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class OutputWriter {
+  public:
+    OutputWriter(std::ostream* out, bool binary);
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+    ~OutputWriter();
+
+    void write_int(int value) {
+        if (used + MAX_VALUE_BYTES > buffer.size()) flush();
+        if (binary) {
+            unsigned int u = (unsigned int) value;
+            buffer[used++] = (char) (u & 0xFF);
+            buffer[used++] = (char) ((u >> 8) & 0xFF);
+            buffer[used++] = (char) ((u >> 16) & 0xFF);
+            buffer[used++] = (char) ((u >> 24) & 0xFF);
+        } else {
+            used += format_int(value, &buffer[used]);
+            buffer[used++] = '\n';
+        }
+    }
+    // Text mode only; used by the wider arithmetic modes
+    void write_int64(long long value) {
+        if (used + MAX_VALUE_BYTES > buffer.size()) flush();
+        used += format_int(value, &buffer[used]);
+        buffer[used++] = '\n';
+    }
+    void write_uint64(unsigned long long value) {
+        if (used + MAX_VALUE_BYTES > buffer.size()) flush();
+        used += format_uint(value, &buffer[used]);
+        buffer[used++] = '\n';
+    }
+    void write_line(const std::string& text);
+    void flush();
+
+  private:
+    static const size_t BUFFER_SIZE = 1 << 16;
+    static const size_t MAX_VALUE_BYTES = 21;   // "-9223372036854775808\n"
+
+    std::ostream* out;
+    bool binary;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    static size_t format_int(long long value, char* dst);
+    static size_t format_uint(unsigned long long value, char* dst);
+};
+
+#endif  //__OUTPUT_WRITER_H__
@@ -0,0 +1,114 @@
+/*
+ * Parallel parsing of the POLY section (--parse-threads N).
+ *
+ * The lexer has already tokenized the whole program, so the POLY token
+ * range is cut at SEMICOLON tokens into one chunk per thread. Each chunk is
+ * parsed by its own Parser into its own arena, and the tables are merged in
+ * chunk order. That is the order the serial parser would have seen the
+ * declarations in, so duplicate lines and last-declaration-wins lookups come
+ * out the same. If any chunk has a syntax error, the parallel result is
+ * dropped and the serial parser runs instead, so errors behave exactly as
+ * before.
+ */
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "parser.h"
+
+using namespace std;
+
+bool Parser::parse_poly_decl_list_parallel()
+{
+    vector<Token>& tokens = lexer.tokens();
+    size_t begin = lexer.position();
+    size_t end = begin;
+    while (end < tokens.size() && tokens[end].token_type != EXECUTE) end++;
+    if (end == tokens.size() || end == begin || tokens[end - 1].token_type != SEMICOLON) return false;
+
+    vector<size_t> bounds = {begin};
+    for (int i = 1; i < parse_threads; i++) {
+        size_t cut = max(begin + (end - begin) * i / parse_threads, bounds.back() + 1);
+        while (cut < end && tokens[cut - 1].token_type != SEMICOLON) cut++;
+        if (cut >= end) break;
+        bounds.push_back(cut);
+    }
+    bounds.push_back(end);
+
+    size_t chunks = bounds.size() - 1;
+    vector<unique_ptr<Parser>> parsers(chunks);
+    vector<unique_ptr<NodeArena>> arenas(chunks);
+    vector<char> ok(chunks, 0);
+    // The chunks borrow their tokens and hand them back after the join
+    for (size_t i = 0; i < chunks; i++) {
+        parsers[i].reset(new Parser(vector<Token>(make_move_iterator(tokens.begin() + bounds[i]),
+                                                  make_move_iterator(tokens.begin() + bounds[i + 1]))));
+        arenas[i].reset(new NodeArena());
+    }
+
+    auto parse_chunk = [&](size_t i) {
+        Parser& chunk = *parsers[i];
+        ostringstream discard;
+        chunk.node_arena = arenas[i].get();
+        chunk.out = &discard;
+        chunk.task_numbers.insert(1);   // make syntax errors throw
+        try {
+            while (true) {
+                chunk.parse_poly_decl();
+                TokenType next = chunk.lexer.peek(1).token_type;
+                if (next == END_OF_FILE) break;
+                if (next != ID) chunk.syntax_error();
+            }
+            chunk.compute_degrees();
+            ok[i] = 1;
+        } catch (const parser_exit_t&) {
+        }
+        chunk.out = &std::cout;
+    };
+
+    vector<thread> workers;
+    for (size_t i = 1; i < chunks; i++) {
+        workers.emplace_back(parse_chunk, i);
+    }
+    parse_chunk(0);
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    for (size_t i = 0; i < chunks; i++) {
+        vector<Token>& chunk_tokens = parsers[i]->lexer.tokens();
+        move(chunk_tokens.begin(), chunk_tokens.end(), tokens.begin() + bounds[i]);
+    }
+    for (char chunk_ok : ok) {
+        if (!chunk_ok) return false;
+    }
+
+    // map::merge splices the nodes of names this parser has not seen yet;
+    // what stays behind in the chunk is a redeclaration
+    for (size_t i = 0; i < chunks; i++) {
+        Parser& chunk = *parsers[i];
+        poly_decl_lines.merge(chunk.poly_decl_lines);
+        for (auto& entry : chunk.poly_decl_lines) {
+            vector<int>& lines = poly_decl_lines[entry.first];
+            lines.insert(lines.end(), entry.second.begin(), entry.second.end());
+        }
+        poly_params.merge(chunk.poly_params);
+        for (auto& entry : chunk.poly_params) {
+            poly_params[entry.first] = std::move(entry.second);
+        }
+        poly_bodies.merge(chunk.poly_bodies);
+        for (const auto& entry : chunk.poly_bodies) {
+            poly_bodies[entry.first] = entry.second;
+        }
+        poly_degree_table.merge(chunk.poly_degree_table);
+        for (const auto& entry : chunk.poly_degree_table) {
+            poly_degree_table[entry.first] = entry.second;
+        }
+        semantic.merge_declarations(chunk.semantic);
+        current_poly = chunk.current_poly;
+        chunk_arenas.push_back(std::move(arenas[i]));
+    }
+    lexer.seek(end);
+    return true;
+}
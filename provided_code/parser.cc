@@ -8,6 +8,7 @@
  *
  */
 #include <iostream>
+#include <cerrno>
 #include <cstdlib>
 #include "parser.h"
 #include <algorithm>
@@ -19,8 +20,8 @@ using namespace std;
 void Parser::syntax_error()
 {
     if (!task_numbers.count(1)) return;
-    cout << "SYNTAX ERROR !!!!!&%!!\n";
-    exit(1);
+    *out << "SYNTAX ERROR !!!!!&%!!\n";
+    throw parser_exit_t{1};
 }
 
 // this function gets a token and checks if it is
@@ -38,6 +39,21 @@ Token Parser::expect(TokenType expected_type)
     return t;
 }
 
+// A NUM that fits in an int. syntax_error() only stops the parse when task 1
+// is requested, so anything else, e.g. the '-' of a negative input, is fatal.
+int Parser::expect_int()
+{
+    Token t = expect(NUM);
+    if (t.token_type == NUM) {
+        try {
+            return std::stoi(t.lexeme);
+        } catch (const std::out_of_range&) {
+        }
+    }
+    std::cerr << "[fatal] line " << t.line_no << ": expected a number that fits in an int" << std::endl;
+    throw parser_exit_t{1};
+}
+
 // Parsing
 // ====== Top-Level Program ======
 void Parser::parse_program()
@@ -45,7 +61,9 @@ void Parser::parse_program()
     parse_tasks_section();
     parse_poly_section();
     parse_execute_section();
-    parse_inputs_section();
+    if (!binary_inputs.is_open() || lexer.peek(1).token_type != END_OF_FILE) {
+        parse_inputs_section();
+    }
     expect(END_OF_FILE);
 }
 
@@ -56,10 +74,10 @@ void Parser::parse_tasks_section() {
 }
 
 void Parser::parse_num_list() {
-    Token num_token = expect(NUM);
-    task_numbers.insert(std::stoi(num_token.lexeme));
+    int value = expect_int();
+    task_numbers.insert(value);
     if (in_inputs_section) {
-        input_values.push_back(std::stoi(num_token.lexeme));
+        input_values.push_back(value);
     }
 
     Token t = lexer.peek(1);
@@ -71,35 +89,27 @@ void Parser::parse_num_list() {
 // ====== POLY Section ======
 void Parser::parse_poly_section() {
     expect(POLY);
-    parse_poly_decl_list();
-
-    std::vector<int> duplicates;
-    for (const auto& pair : poly_decl_lines) {
-        const std::vector<int>& lines = pair.second;
-        if (lines.size() > 1) {
-            duplicates.insert(duplicates.end(), lines.begin() + 1, lines.end());
-        }
+    if (parse_threads <= 1 || !parse_poly_decl_list_parallel()) {
+        parse_poly_decl_list();
+        begin_phase("degree");
+        compute_degrees();
+        end_phase();
     }
 
+    begin_phase("semantic");
+    report_poly_errors();
+    end_phase();
+}
+
+void Parser::report_poly_errors() {
     if (task_numbers.count(1)) {
-        if (!duplicates.empty()) {
-            std::sort(duplicates.begin(), duplicates.end(), std::less<int>());
-            std::cout << "Semantic Error Code 1:";
-            for (int line : duplicates) {
-                std::cout << " " << line;
-            }
-            std::cout << std::endl;
-            exit(0);
+        if (!semantic.duplicate_decls.empty()) {
+            print_lines(*out, "Semantic Error Code 1", semantic.duplicate_decls);
+            throw parser_exit_t{0};
         }
-
-        if (!invalid_lines.empty()) {
-            std::sort(invalid_lines.begin(), invalid_lines.end());
-            std::cout << "Semantic Error Code 2:";
-            for (int line : invalid_lines) {
-                std::cout << " " << line;
-            }
-            std::cout << std::endl;
-            exit(0);
+        if (!semantic.invalid_vars.empty()) {
+            print_lines(*out, "Semantic Error Code 2", semantic.invalid_vars);
+            throw parser_exit_t{0};
         }
     }
 }
@@ -126,6 +136,7 @@ void Parser::parse_poly_header() {
     std::string name = id_token.lexeme;
     int line = id_token.line_no;
     poly_decl_lines[name].push_back(line);
+    semantic.declare_poly(name, line);
 
     current_poly = name;
 
@@ -154,10 +165,10 @@ std::vector<std::string> Parser::parse_id_list() {
 
 poly_body_t* Parser::parse_poly_body() {
     term_list_t* terms = parse_term_list();
-    poly_body_t* body = new poly_body_t;
+    poly_body_t* body = node_arena->make<poly_body_t>();
     body->terms = terms;
+    flatten_poly(body, poly_params[current_poly]);
     poly_bodies[current_poly] = body;
-    poly_degree_table[current_poly] = get_degree(terms);
     return body;
 }
 
@@ -167,17 +178,16 @@ term_list_t* Parser::parse_term_list() {
     if (t1.token_type == PLUS || t1.token_type == MINUS) {
         leading_op = parse_add_operator();
     }
-    term_t* first_term = parse_term();
-    term_list_t* node = new term_list_t;
-    node->term = first_term;
-    node->op = leading_op;
+    term_list_t node;
+    node.term = parse_term();
+    node.op = leading_op;
     Token t2 = lexer.peek(1);
     if (t2.token_type == PLUS || t2.token_type == MINUS) {
-        node->next = parse_term_list();
+        node.next = parse_term_list();
     } else {
-        node->next = nullptr;
+        node.next = nullptr;
     }
-    return node;
+    return node_arena->intern(node);
 }
 
 OperatorType Parser::parse_add_operator() {
@@ -196,22 +206,22 @@ OperatorType Parser::parse_add_operator() {
 
 term_t* Parser::parse_term() {
     Token t = lexer.peek(1);
-    term_t* term = new term_t;
+    term_t term = {};
     if (t.token_type == NUM) {
-        term->coefficient = parse_coefficient();
+        term.coefficient = parse_coefficient();
         t = lexer.peek(1);
         if (t.token_type == ID || t.token_type == LPAREN) {
-            term->monomial_list = parse_monomial_list();
+            term.monomial_list = parse_monomial_list();
         } else {
-            term->monomial_list = {};
+            term.monomial_list = {};
         }
     } else if (t.token_type == ID || t.token_type == LPAREN) {
-        term->coefficient = 1;
-        term->monomial_list = parse_monomial_list();
+        term.coefficient = 1;
+        term.monomial_list = parse_monomial_list();
     } else {
         syntax_error();
     }
-    return term;
+    return node_arena->intern(std::move(term));
 }
 
 std::vector<monomial_t*> Parser::parse_monomial_list() {
@@ -231,99 +241,98 @@ std::vector<monomial_t*> Parser::parse_monomial_list() {
 
 monomial_t* Parser::parse_monomial() {
     Token t = lexer.peek(1);
-    monomial_t* monomial = new monomial_t;
+    monomial_t monomial = {};
     if (t.token_type == ID || t.token_type == LPAREN) {
-        monomial->primary = parse_primary();
+        monomial.primary = parse_primary();
         t = lexer.peek(1);
         if (t.token_type == POWER) {
-            monomial->exponent = parse_exponent();
+            monomial.exponent = parse_exponent();
         } else {
-            monomial->exponent = 1;
+            monomial.exponent = 1;
         }
     } else {
         syntax_error();
     }
 
-    return monomial;
+    return node_arena->intern(monomial);
 }
 
 int Parser::parse_coefficient() {
-    Token t = expect(NUM);
-    return std::stoi(t.lexeme);
+    return expect_int();
 }
 
 int Parser::parse_exponent() {
     expect(POWER);
-    Token t = expect(NUM);
-    return std::stoi(t.lexeme);
+    return expect_int();
 }
 
 primary_t* Parser::parse_primary() {
     Token t = lexer.peek(1);
-    primary_t* primary = new primary_t;
+    primary_t primary = {};
     if (t.token_type == ID) {
         Token id_token = expect(ID);
         std::string var_name = id_token.lexeme;
-        if (poly_params.find(current_poly) != poly_params.end()) {
-            std::vector<std::string> allowed_vars = poly_params[current_poly];
+        auto params = poly_params.find(current_poly);
+        if (params != poly_params.end()) {
+            const std::vector<std::string>& allowed_vars = params->second;
             if (std::find(allowed_vars.begin(), allowed_vars.end(), var_name) == allowed_vars.end()) {
-                invalid_lines.push_back(id_token.line_no);
+                semantic.invalid_variable(id_token.line_no);
             }
         } else {
             if (var_name != "x") {
-                invalid_lines.push_back(id_token.line_no);
+                semantic.invalid_variable(id_token.line_no);
             }
         }
 
-        primary->kind = VAR;
-        primary->var_name = var_name;
-        primary->term_list = nullptr;
+        primary.kind = VAR;
+        primary.var_name = var_name;
+        primary.term_list = nullptr;
     } else if (t.token_type == LPAREN) {
         expect(LPAREN);
         term_list_t* term_list =parse_term_list();
         expect(RPAREN);
-        primary->kind = TERM_LIST;
-        primary->term_list = term_list;
-        primary->var_name = "";
+        primary.kind = TERM_LIST;
+        primary.term_list = term_list;
+        primary.var_name = "";
     } else {
         syntax_error();
     }
 
-    return primary;
+    return node_arena->intern(std::move(primary));
 }
 
 // ====== EXECUTE Section ======
 void Parser::parse_execute_section() {
-    expect(EXECUTE);
+    execute_line = expect(EXECUTE).line_no;
     stmt_list_head = parse_statement_list();
     if (stmt_list_head == nullptr) {
         std::cerr << "[fatal] no statements parsed in EXECUTE section\n";
         syntax_error();
     } 
 
+    begin_phase("semantic");
+    report_execute_errors();
+    end_phase();
+}
+
+void Parser::report_execute_errors() {
     if (task_numbers.count(1)) {
-        if (!undeclared_eval_lines.empty()) {
-            std::sort(undeclared_eval_lines.begin(), undeclared_eval_lines.end());
-            std::cout << "Semantic Error Code 3:";
-            for (int line : undeclared_eval_lines) {
-                std::cout << " " << line;
-            }
-            std::cout << std::endl;
-            exit(0);
+        if (!semantic.undeclared_calls.empty()) {
+            print_lines(*out, "Semantic Error Code 3", semantic.undeclared_calls);
+            throw parser_exit_t{0};
         }
-
-        if (!wrong_arity_lines.empty()) {
-            std::sort(wrong_arity_lines.begin(), wrong_arity_lines.end());
-            std::cout << "Semantic Error Code 4:";
-            for (int line : wrong_arity_lines) {
-                std::cout << " " << line;
-            }
-            std::cout << std::endl;
-            exit(0);
+        if (!semantic.wrong_arity_lines.empty()) {
+            print_lines(*out, "Semantic Error Code 4", semantic.wrong_arity_lines);
+            throw parser_exit_t{0};
         }
     }
 }
 
+void Parser::report_semantic_errors() {
+    report_poly_errors();
+    report_execute_errors();
+}
+
 stmt_t* Parser::parse_statement_list() {
     stmt_t* first = parse_statement();
     stmt_t* current = first;
@@ -351,22 +360,29 @@ stmt_t* Parser::parse_statement() {
     }
 }
 
+// Variables are numbered in order of first appearance
+int Parser::variable_id(const std::string& name) {
+    auto loc = location_table.find(name);
+    if (loc != location_table.end()) return loc->second;
+    location_table[name] = next_available++;
+    variable_names.push_back(name);
+    return next_available - 1;
+}
+
 stmt_t* Parser::parse_input_statement() {
     expect(INPUT);
     Token id_token = expect(ID);
     expect(SEMICOLON);
 
     std::string var_name = id_token.lexeme;
-    if (location_table.find(var_name) == location_table.end()) {
-        location_table[var_name] = next_available++;
-    }
-    initialized_vars.insert(var_name);
+    int id = variable_id(var_name);
+    semantic.input(var_name);
     input_vars_in_order.push_back(var_name);
 
 
-    stmt_t* stmt = new stmt_t;
+    stmt_t* stmt = node_arena->make<stmt_t>();
     stmt->type = STMT_INPUT;
-    stmt->var = location_table[var_name];
+    stmt->var = id;
     stmt->line_no = id_token.line_no;
     return stmt;
 }
@@ -377,13 +393,11 @@ stmt_t* Parser::parse_output_statement() {
     expect(SEMICOLON);
 
     std::string var_name = id_token.lexeme;
-    if (location_table.find(var_name) == location_table.end()) {
-        location_table[var_name] = next_available++;
-    }
+    semantic.output(var_name);
 
-    stmt_t* stmt = new stmt_t;
+    stmt_t* stmt = node_arena->make<stmt_t>();
     stmt->type = STMT_OUTPUT;
-    stmt->var = location_table[var_name];
+    stmt->var = variable_id(var_name);
     stmt->line_no = id_token.line_no;
     return stmt;
 }
@@ -391,24 +405,15 @@ stmt_t* Parser::parse_output_statement() {
 stmt_t* Parser::parse_assign_statement() {
     Token lhs_token = expect(ID);
     std::string lhs_name = lhs_token.lexeme;
-    if (location_table.find(lhs_name) == location_table.end()) {
-        location_table[lhs_name] = next_available++;
-    }
+    int lhs = variable_id(lhs_name);
     expect(EQUAL);
     poly_eval_t* eval = parse_poly_evaluation();
     expect(SEMICOLON);
 
-    stmt_t* stmt = new stmt_t;
+    stmt_t* stmt = node_arena->make<stmt_t>();
     stmt->type = STMT_ASSIGN;
-    if (task_numbers.count(3)) {
-        for (const std::string& arg : eval->args) {
-            if (initialized_vars.find(arg) == initialized_vars.end()) {
-                warning_lines_uninitialized.push_back(lhs_token.line_no);
-            }
-        }
-    }
-    initialized_vars.insert(lhs_name);
-    stmt->lhs = location_table[lhs_name];
+    semantic.assign(lhs_name, eval->args, lhs_token.line_no, task_numbers.count(3) != 0);
+    stmt->lhs = lhs;
     stmt->eval = eval;
     stmt->line_no = lhs_token.line_no;
     return stmt;
@@ -418,34 +423,35 @@ poly_eval_t* Parser::parse_poly_evaluation() {
     Token id_token = expect(ID);
     std::string poly_name = id_token.lexeme;
     int line = id_token.line_no;
-    if (poly_decl_lines.find(poly_name) == poly_decl_lines.end()) {
-        undeclared_eval_lines.push_back(line);
+    bool undeclared = !semantic.is_declared(poly_name);
+    if (undeclared) {
+        semantic.undeclared_call(line);
     }
     expect(LPAREN);
     std::vector<std::string> args = parse_argument_list();
     expect(RPAREN);
 
-    if (poly_params.find(poly_name) != poly_params.end()) {
-        std::vector<std::string> expected_params = poly_params[poly_name];
-        if (args.size() != expected_params.size()) {
-            if (std::find(wrong_arity_lines.begin(), wrong_arity_lines.end(), line) == wrong_arity_lines.end()) {
-                wrong_arity_lines.push_back(line);
-            }
-        }
-    } else {
-        if (args.size() != 1) {
-            if (std::find(wrong_arity_lines.begin(), wrong_arity_lines.end(), line) == wrong_arity_lines.end()) {
-                wrong_arity_lines.push_back(line);
-            }
-        }
+    // checked after the arguments, so a nested call on a later line comes first
+    bool wrong_arity = arity_mismatch(poly_name, args.size());
+    if (wrong_arity) {
+        semantic.add_wrong_arity(line);
     }
+    poly_calls_by_name[poly_name].push_back(poly_calls.size());
+    poly_calls.push_back({poly_name, args.size(), line, undeclared, wrong_arity});
 
-    poly_eval_t* eval = new poly_eval_t;
+    poly_eval_t* eval = node_arena->make<poly_eval_t>();
     eval->name = poly_name;
     eval->args = args;
     return eval;
 }
 
+// Polynomials that were never declared are checked as taking one argument
+bool Parser::arity_mismatch(const std::string& poly_name, size_t arg_count) {
+    auto params = poly_params.find(poly_name);
+    size_t expected = (params != poly_params.end()) ? params->second.size() : 1;
+    return arg_count != expected;
+}
+
 std::vector<std::string> Parser::parse_argument_list() {
     std::vector<std::string> args;
     parse_argument(args);
@@ -475,197 +481,213 @@ void Parser::parse_argument(std::vector<std::string>& args) {
     }
 }
 
-int Parser::get_degree(term_list_t* term_list) {
-    if (term_list == nullptr) return 0;
-    int left = get_degree(term_list->term);
-    int right = get_degree(term_list->next);
-    return std::max(left, right);
-}
-
-int Parser::get_degree(term_t* term) {
-    return get_degree(term->monomial_list);
-}
-
-int Parser::get_degree(const std::vector<monomial_t*>& monomial_list) {
-    int degree = 0;
-    for (monomial_t* monomial : monomial_list) {
-        degree += get_degree(monomial);
+void Parser::compute_degrees() {
+    for (const auto& entry : poly_bodies) {
+        poly_degree_table[entry.first] = get_degree(entry.second->flat);
     }
-    return degree;
 }
 
-int Parser::get_degree(monomial_t* monomial) {
-    int base = get_degree(monomial->primary);
-    return base * monomial->exponent;
-}
-
-int Parser::get_degree(primary_t* primary) {
-    if (primary->kind == VAR) {
-        return 1;
-    } else if (primary->kind == TERM_LIST) {
-        return get_degree(primary->term_list);
+void Parser::compile_jit_table() {
+    jit_table.clear();
+    if (!PolyJit::available()) return;
+    for (const auto& entry : poly_bodies) {
+        // a nullptr entry means the tree walker handles this polynomial;
+        // bodies with a wide list run faster on the SIMD kernel
+        const flat_poly_t& flat = entry.second->flat;
+        bool wide = wide_kernel != WIDE_OFF && !flat.wide.empty();
+        jit_table[entry.first] = wide ? nullptr : jit.compile(entry.second, poly_params[entry.first]);
     }
-    return 0;
 }
 
-
-void Parser::execute_program() {
-    std::fill(memory.begin(), memory.end(), 0);
-    stmt_t* current = stmt_list_head;
-    input_counter = 0;
-
-    for (size_t i = 0; i < input_vars_in_order.size(); ++i) {
-        int value = (i < input_values.size()) ? input_values[i] : 0;
-        int loc = location_table[input_vars_in_order[i]];
-        memory[loc] = value;
-    }
-    while (current != nullptr) {
-        switch (current->type) {
-            case STMT_INPUT: {
-                break;
-            }
-            case STMT_OUTPUT: {
-                std::cout << memory[current->var] << std::endl;
-                break;
-            }
-            case STMT_ASSIGN: {
-                poly_eval_t* eval = static_cast<poly_eval_t*>(current->eval);
-                std::string poly_name = eval->name;
-                std::vector<std::string> args = eval->args;
-                current_poly = poly_name;
-                std::map<std::string, int> arg_values;
-                const std::vector<std::string>& params = poly_params[poly_name];
-                if (params.size() != args.size()) {
-                    std::cerr << "[fatal] wrong number of arguments for poly " << poly_name << std::endl;
-                    exit(1);
-                }
-                for (size_t i = 0; i < args.size(); ++i) {
-                    const std::string& actual = args[i];
-                    const std::string& expected = params[i];
-                    int value;
-                    if (isdigit(actual[0]) || (actual[0] == '-' && actual.length() > 1)) {
-                        value = std::stoi(actual);
-                    } else {
-                        value = memory[location_table[actual]];
-                    }
-                    arg_values[params[i]] = value;
+void Parser::collect_ast_stats() {
+    if (!stats) return;
+    std::map<std::string, long long>& counts = stats->node_counts;
+    std::vector<term_list_t*> pending;
+    for (const auto& entry : poly_bodies) {
+        counts["poly_body"]++;
+        pending.push_back(entry.second->terms);
+    }
+    while (!pending.empty()) {
+        term_list_t* node = pending.back();
+        pending.pop_back();
+        for (; node != nullptr; node = node->next) {
+            counts["term_list"]++;
+            counts["term"]++;
+            for (monomial_t* monomial : node->term->monomial_list) {
+                counts["monomial"]++;
+                counts["primary"]++;
+                if (monomial->primary->kind == TERM_LIST) {
+                    pending.push_back(monomial->primary->term_list);
                 }
-                memory[current->lhs] = evaluate_poly(poly_bodies[poly_name], arg_values, location_table);
-                break;
             }
         }
-        current = current->next;
+    }
+    for (stmt_t* stmt = stmt_list_head; stmt != nullptr; stmt = stmt->next) {
+        counts["stmt"]++;
+        if (stmt->type == STMT_ASSIGN) {
+            counts["poly_eval"]++;
+        }
+    }
+    stats->interned_nodes = arena.interned_nodes();
+    stats->unique_nodes = arena.unique_nodes();
+    for (const auto& chunk : chunk_arenas) {
+        stats->interned_nodes += chunk->interned_nodes();
+        stats->unique_nodes += chunk->unique_nodes();
     }
 }
 
-int Parser::evaluate_poly(poly_body_t* body, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table) {
-    for (const auto& entry : arg_values) {
-        const std::string& param = entry.first;
-        int value = entry.second;
+// Frame, free variables, native code and instrumentation for a run
+void Parser::prepare_execution() {
+    incremental_ready = false;
+    allocate_frame();
+    memory.assign(frame_size, 0);
+    resolve_free_vars();
+    if (use_jit) {
+        compile_jit_table();
     }
-
-    int result = 0;
-    term_list_t* current_term = body->terms;
-    while (current_term != nullptr) {
-        term_t* term = current_term->term;
-        int term_value = evaluate_term(term, arg_values, location_table);
-
-        if (current_term->op == OP_PLUS || current_term->op == OP_NONE) {
-            result += term_value;
-        } else if (current_term->op == OP_MINUS) {
-            result -= term_value;
+    if (stats || profiler) {
+        for (const auto& entry : poly_bodies) {
+            poly_mult_count[entry.first] = count_multiplications(entry.second->flat);
         }
-
-        current_term = current_term->next;
     }
-    return result;
 }
 
-int Parser::evaluate_term(term_t* term, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table) {
-    int product = 1;
-    for (monomial_t* monomial : term->monomial_list) {
-        product *= evaluate_monomial(monomial, arg_values, location_table);
+void Parser::execute_program() {
+    prepare_execution();
+    if (arith_mode == ARITH_CHECKED) {
+        execute_program_checked();
+        return;
     }
+    if (arith_mode == ARITH_MOD) {
+        execute_program_mod();
+        return;
+    }
+    OutputWriter writer(out, binary_output);
+    input_counter = 0;
 
-    return term->coefficient * product;
+    for (size_t i = 0; i < input_vars_in_order.size(); ++i) {
+        memory[frame_slot(input_vars_in_order[i])] = input_value(i);
+    }
+    lower_program();
+    run_program(writer);
 }
 
-int Parser::evaluate_monomial(monomial_t* monomial, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table) { 
-    int base = evaluate_primary(monomial->primary, arg_values, location_table);
-    int exponent = monomial->exponent;
-    int result = 1;
-    for (int i = 0; i < exponent; ++i) {
-        result *= base;
+// Variable id of an argument
+int Parser::argument_id(const std::string& name) {
+    auto loc = location_table.find(name);
+    if (loc != location_table.end()) return loc->second;
+    // an argument that is never assigned gets location 0, which free
+    // variables with the same name see from now on
+    location_table[name] = 0;
+    resolve_free_vars();
+    // diagnostics name location 0 after the first name bound to it
+    if (name < variable_names[0]) {
+        variable_names[0] = name;
+        first_variable_renamed = true;
     }
-    return result;
+    return 0;
 }
 
-int Parser::evaluate_primary(primary_t* primary, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table) {
-    if (primary->kind == VAR) {
-        if (arg_values.find(primary->var_name) != arg_values.end()) {
-            return arg_values.at(primary->var_name);
-        } else if (location_table.find(primary->var_name) != location_table.end()) {
-            return memory[location_table.at(primary->var_name)];
+// Generic form of an assignment, for the statements lower_program() leaves
+// as they are
+void Parser::execute_assign(stmt_t* current) {
+    poly_eval_t* eval = static_cast<poly_eval_t*>(current->eval);
+    const std::string& poly_name = eval->name;
+    const std::vector<std::string>& args = eval->args;
+    current_poly = poly_name;
+    const std::vector<std::string>& params = poly_params[poly_name];
+    if (params.size() != args.size()) {
+        std::cerr << "[fatal] wrong number of arguments for poly " << poly_name << std::endl;
+        throw parser_exit_t{1};
+    }
+    if (stats) {
+        stats->poly_evaluations++;
+        stats->multiplications += poly_mult_count[poly_name];
+    }
+    // padded so the JIT can always be passed JIT_MAX_PARAMS values
+    arg_buffer.assign(std::max(args.size(), (size_t) JIT_MAX_PARAMS), 0);
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& actual = args[i];
+        if (is_literal(actual)) {
+            arg_buffer[i] = std::stoi(actual);
         } else {
-            return 0;
+            arg_buffer[i] = memory[frame[argument_id(actual)]];
         }
-    } else if (primary->kind == TERM_LIST) {
-        return evaluate_poly(new poly_body_t{primary->term_list}, arg_values, location_table);
+    }
+    unsigned long long start = profiler ? Profiler::now() : 0;
+    jit_fn_t compiled = nullptr;
+    if (use_jit) {
+        auto entry = jit_table.find(poly_name);
+        if (entry != jit_table.end()) compiled = entry->second;
+    }
+    if (compiled != nullptr) {
+        const int* v = arg_buffer.data();
+        memory[frame[current->lhs]] = compiled(v[0], v[1], v[2], v[3], v[4], v[5]);
     } else {
-        exit(1);
+        memory[frame[current->lhs]] = evaluate_flat(poly_bodies[poly_name]->flat, arg_buffer.data());
+    }
+    if (profiler) {
+        profiler->record(poly_name, current->line_no, poly_mult_count[poly_name], Profiler::now() - start);
     }
 }
 
 void Parser::check_useless_assignments() {
-    std::set<std::string> used_vars;
-    std::vector<stmt_t*> statements;
-    stmt_t* current = stmt_list_head;
-    while (current != nullptr) {
-        statements.push_back(current);
-        current = current->next;
-    }
-
-    // First pass: collect all variables used in OUTPUT statements
-    for (int i = statements.size() - 1; i >= 0; --i) {
-        stmt_t* stmt = statements[i];
+    if (!first_variable_renamed) {
+        semantic.finish_assignments();
+        return;
+    }
+    // Every assignment to or OUTPUT of variable 0 now goes by the name
+    // argument_id() gave it, while arguments keep their own names, so the
+    // statements are analyzed again under those names
+    SemanticAnalyzer renamed;
+    for (stmt_t* stmt = stmt_list_head; stmt != nullptr; stmt = stmt->next) {
         if (stmt->type == STMT_OUTPUT) {
-            for (const auto& entry : location_table) {
-                if (entry.second == stmt->var) {
-                    used_vars.insert(entry.first);
-                    break;
-                }
-            }
+            renamed.output(variable_names[stmt->var]);
+        } else if (stmt->type == STMT_ASSIGN) {
+            const std::vector<std::string>& args = static_cast<poly_eval_t*>(stmt->eval)->args;
+            renamed.assign(variable_names[stmt->lhs], args, stmt->line_no, false);
         }
     }
+    renamed.finish_assignments();
+    semantic.useless_assignments = renamed.useless_assignments;
+}
 
-    // Second pass: track assignments and mark useless ones
-    for (int i = statements.size() - 1; i >= 0; --i) {
-        stmt_t* stmt = statements[i];
-        if (stmt->type == STMT_ASSIGN) {
-            std::string lhs_name;
-            for (const auto& entry : location_table) {
-                if (entry.second == stmt->lhs) {
-                    lhs_name = entry.first;
-                    break;
-                }
-            }
-
-            poly_eval_t* eval = static_cast<poly_eval_t*>(stmt->eval);
-            // Add all variables used in the evaluation to used_vars
-            for (const std::string& arg : eval->args) {
-                if (isdigit(arg[0]) || (arg[0] == '-' && arg.length() > 1)) continue;
-                used_vars.insert(arg);
-            }
-
-            // Check if the assigned variable is used
-            if (!lhs_name.empty() && used_vars.find(lhs_name) == used_vars.end()) {
-                useless_assignments.push_back(stmt->line_no);
-            } else {
-                used_vars.erase(lhs_name);  // Remove it so we can detect earlier useless assignments
-            }
+void Parser::recheck_semantics() {
+    SemanticAnalyzer checked;
+    std::vector<std::pair<int, std::string>> decls;
+    for (const auto& entry : poly_decl_lines) {
+        for (int line : entry.second) {
+            decls.push_back({line, entry.first});
         }
     }
-    std::sort(useless_assignments.begin(), useless_assignments.end());
+    std::sort(decls.begin(), decls.end());
+    for (const auto& decl : decls) {
+        checked.declare_poly(decl.second, decl.first);
+    }
+    // only the lines of invalid variables outlive the parse
+    for (int line : semantic.invalid_vars) {
+        checked.invalid_variable(line);
+    }
+    for (const poly_call_t& call : poly_calls) {
+        if (!checked.is_declared(call.name)) {
+            checked.undeclared_call(call.line);
+        }
+        if (arity_mismatch(call.name, call.arg_count)) {
+            checked.add_wrong_arity(call.line);
+        }
+    }
+    bool check_uninitialized = task_numbers.count(3) != 0;
+    for (stmt_t* stmt = stmt_list_head; stmt != nullptr; stmt = stmt->next) {
+        if (stmt->type == STMT_INPUT) {
+            checked.input(variable_names[stmt->var]);
+        } else if (stmt->type == STMT_OUTPUT) {
+            checked.output(variable_names[stmt->var]);
+        } else {
+            const std::vector<std::string>& args = static_cast<poly_eval_t*>(stmt->eval)->args;
+            checked.assign(variable_names[stmt->lhs], args, stmt->line_no, check_uninitialized);
+        }
+    }
+    semantic = std::move(checked);
 }
 
 // ====== INPUTS Section ======
@@ -676,57 +698,240 @@ void Parser::parse_inputs_section() {
     in_inputs_section = false;
 }
 
-int main()
+// Values from a binary inputs file replace the INPUTS section
+int Parser::input_value(size_t i) const {
+    if (binary_inputs.is_open() && !inputs_edited) {
+        return (i < binary_inputs.size()) ? binary_inputs.data()[i] : 0;
+    }
+    return (i < input_values.size()) ? input_values[i] : 0;
+}
+
+// Runs the requested tasks once the program has parsed without errors
+void Parser::run_tasks()
 {
-    Parser parser;
-    parser.parse_program();
-
-    // Check for semantic errors first
-    if (parser.task_numbers.count(1)) {
-        if (!parser.wrong_arity_lines.empty()) {
-            std::sort(parser.wrong_arity_lines.begin(), parser.wrong_arity_lines.end());
-            std::cout << "Semantic Error Code 4:";
-            for (int line : parser.wrong_arity_lines) {
-                std::cout << " " << line;
-            }
-            std::cout << std::endl;
-            return 0;
+    // INPUTS values join task_numbers, so task 1 may only have been
+    // requested after parse_program() checked the EXECUTE section
+    if (task_numbers.count(1) && !semantic.wrong_arity_lines.empty()) {
+        print_lines(*out, "Semantic Error Code 4", semantic.wrong_arity_lines);
+        return;
+    }
+
+    if (task_numbers.count(2)) {
+        begin_phase("execute");
+        execute_program();
+        end_phase();
+    }
+
+    begin_phase("semantic");
+
+    if (task_numbers.count(3) && !semantic.uninitialized_args.empty()) {
+        print_lines(*out, "Warning Code 1", semantic.uninitialized_args);
+    }
+
+    if (task_numbers.count(4)) {
+        check_useless_assignments();
+        if (!semantic.useless_assignments.empty()) {
+            print_lines(*out, "Warning Code 2", semantic.useless_assignments);
         }
     }
 
-    if (parser.task_numbers.count(2)) {
-        parser.execute_program();
+    end_phase();
+
+    if (task_numbers.count(5)) {
+        for (const auto& entry : poly_degree_table) {
+            std::string poly_name = entry.first;
+            int degree = entry.second;
+            *out << poly_name << ": " << degree << std::endl;
+        }
     }
+}
 
-    if (parser.task_numbers.count(3)) {
-        if (!parser.warning_lines_uninitialized.empty()) {
-            std::sort(parser.warning_lines_uninitialized.begin(), parser.warning_lines_uninitialized.end());
-            std::cout << "Warning Code 1:";
-            for (int line : parser.warning_lines_uninitialized) {
-                std::cout << " " << line;
+#ifndef PARSER_NO_MAIN
+static void usage(const char* prog)
+{
+    std::cerr << "usage: " << prog << " [--jit] [--emit-cpp] [--expand] [--binary-output] [--inputs-bin FILE]\n"
+              << "       [--arith=int|checked] [--mod P] [--parse-threads N] [--lex-threads N]\n"
+              << "       [--pipeline] [--profile[=FILE]] [--stats[=json]] < program.txt\n"
+              << "  --jit       evaluate polynomials with native x86-64 code, falling back\n"
+              << "              to the tree walker for bodies that cannot be compiled; only\n"
+              << "              the calls get faster, not lowering the EXECUTE section, which\n"
+              << "              takes most of the time of a short run\n"
+              << "  --emit-cpp  print a standalone C++ program equivalent to the EXECUTE\n"
+              << "              section instead of running the tasks\n"
+              << "  --expand    print every polynomial multiplied out into monomials, with\n"
+              << "              coefficients wrapped to int, instead of running the tasks\n"
+              << "  --binary-output\n"
+              << "              write OUTPUT values as raw 32-bit little-endian integers\n"
+              << "  --inputs-bin FILE\n"
+              << "              read the INPUTS values from FILE, a binary array of 32-bit\n"
+              << "              little-endian integers; the INPUTS section may be omitted\n"
+              << "  --arith=int|checked\n"
+              << "              int (default) wraps like C++ int; checked evaluates in 64-bit\n"
+              << "              integers and switches a statement to arbitrary precision\n"
+              << "              when it overflows\n"
+              << "  --mod P     evaluate every statement modulo the odd 64-bit prime P\n"
+              << "              and print residues in [0, P)\n"
+              << "  --parse-threads N\n"
+              << "              parse the POLY declarations in N chunks on N threads\n"
+              << "  --lex-threads N\n"
+              << "              tokenize the input in N chunks on N threads\n"
+              << "  --pipeline  tokenize on a separate thread while the parser consumes the\n"
+              << "              tokens, so reading the input overlaps with parsing\n"
+              << "  --profile[=FILE]\n"
+              << "              report calls, cycles and multiplications per polynomial and\n"
+              << "              per EXECUTE line on stderr, and write folded stacks for\n"
+              << "              flamegraph.pl to FILE (default profile.folded)\n"
+              << "  --stats     report per-phase time, peak RSS, allocations and\n"
+              << "              evaluation counters on stderr (--stats=json for JSON)\n";
+}
+
+// Kept at namespace scope so the report can still be printed from an atexit
+// handler when a semantic error ends the run early.
+static RunStats run_stats;
+static bool stats_json = false;
+
+static void print_stats()
+{
+    run_stats.report(std::cerr, stats_json);
+}
+
+static Profiler run_profile;
+static std::string profile_path = "profile.folded";
+
+static void print_profile()
+{
+    run_profile.report(std::cerr);
+    if (!run_profile.write_folded(profile_path)) {
+        std::cerr << "cannot write " << profile_path << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool use_jit = false;
+    bool emit_cpp = false;
+    bool expand = false;
+    bool binary_output = false;
+    bool use_stats = false;
+    bool use_profile = false;
+    std::string inputs_bin;
+    ArithMode arith_mode = ARITH_INT;
+    uint64_t modulus = 0;
+    int parse_threads = 1;
+    int lex_threads = 1;
+    bool pipeline = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--jit") {
+            use_jit = true;
+        } else if (arg == "--emit-cpp") {
+            emit_cpp = true;
+        } else if (arg == "--expand") {
+            expand = true;
+        } else if (arg == "--binary-output") {
+            binary_output = true;
+        } else if (arg == "--inputs-bin" && i + 1 < argc) {
+            inputs_bin = argv[++i];
+        } else if (arg == "--arith=int") {
+            arith_mode = ARITH_INT;
+        } else if (arg == "--arith=checked") {
+            arith_mode = ARITH_CHECKED;
+        } else if (arg == "--mod" && i + 1 < argc) {
+            char* end = nullptr;
+            errno = 0;
+            modulus = strtoull(argv[++i], &end, 10);
+            if (errno != 0 || *end != '\0' || argv[i][0] == '-' || !is_mod_modulus(modulus)) {
+                std::cerr << "--mod: modulus must be an odd 64-bit prime" << std::endl;
+                return 1;
             }
-            std::cout << std::endl;
+            arith_mode = ARITH_MOD;
+        } else if (arg == "--parse-threads" && i + 1 < argc) {
+            parse_threads = atoi(argv[++i]);
+            if (parse_threads < 1) {
+                std::cerr << "--parse-threads: expected a positive thread count" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--lex-threads" && i + 1 < argc) {
+            lex_threads = atoi(argv[++i]);
+            if (lex_threads < 1) {
+                std::cerr << "--lex-threads: expected a positive thread count" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pipeline") {
+            pipeline = true;
+        } else if (arg == "--profile" || arg.compare(0, 10, "--profile=") == 0) {
+            use_profile = true;
+            if (arg.size() > 10) profile_path = arg.substr(10);
+        } else if (arg == "--stats" || arg == "--stats=json") {
+            use_stats = true;
+            stats_json = (arg == "--stats=json");
+        } else {
+            usage(argv[0]);
+            return 1;
         }
     }
 
-    if (parser.task_numbers.count(4)) {
-        parser.check_useless_assignments();
-        if (!parser.useless_assignments.empty()) {
-            std::sort(parser.useless_assignments.begin(), parser.useless_assignments.end());
-            std::cout << "Warning Code 2:";
-            for (int line : parser.useless_assignments) {
-                std::cout << " " << line;
-            }
-            std::cout << std::endl;
+    if (binary_output && arith_mode != ARITH_INT) {
+        std::cerr << "--binary-output requires --arith=int" << std::endl;
+        return 1;
+    }
+
+    if (pipeline && lex_threads > 1) {
+        std::cerr << "--pipeline cannot be combined with --lex-threads" << std::endl;
+        return 1;
+    }
+
+    if (use_stats) {
+        count_heap_allocations();
+        atexit(print_stats);
+        run_stats.begin_phase("lex");
+    }
+    Parser parser(std::cin, lex_threads, pipeline);
+    if (use_stats) {
+        run_stats.end_phase();
+        run_stats.tokens = parser.token_count();
+        parser.stats = &run_stats;
+    }
+    if (use_profile) {
+        atexit(print_profile);
+        parser.profiler = &run_profile;
+    }
+    parser.use_jit = use_jit;
+    parser.parse_threads = parse_threads;
+    parser.binary_output = binary_output;
+    parser.arith_mode = arith_mode;
+    if (arith_mode == ARITH_MOD) {
+        parser.mont = Montgomery(modulus);
+    }
+    if (!inputs_bin.empty()) {
+        std::string error;
+        if (!parser.load_binary_inputs(inputs_bin, error)) {
+            std::cerr << error << std::endl;
+            return 1;
         }
     }
 
-    if (parser.task_numbers.count(5)) {
-        for (const auto& entry : parser.poly_degree_table) {
-            std::string poly_name = entry.first;
-            int degree = entry.second;
-            std::cout << poly_name << ": " << degree << std::endl;
+    try {
+        parser.begin_phase("parse");
+        parser.parse_program();
+        parser.end_phase();
+        if (use_stats) {
+            run_stats.tokens = parser.token_count();
+        }
+        parser.collect_ast_stats();
+
+        if (emit_cpp) {
+            parser.emit_cpp(std::cout);
+            return 0;
+        }
+        if (expand) {
+            parser.expand_polys(std::cout);
+            return 0;
         }
+        parser.run_tasks();
+    } catch (const parser_exit_t& e) {
+        return e.status;
     }
     return 0;
 }
+#endif  // PARSER_NO_MAIN
@@ -6,12 +6,27 @@
 #ifndef __PARSER_H__
 #define __PARSER_H__
 
+#include <cctype>
+#include <iostream>
 #include <string>
+#include "arena.h"
+#include "node_arena.h"
+#include "bigint.h"
 #include "lexer.h"
+#include "modarith.h"
+#include "mapped_inputs.h"
+#include "output_writer.h"
+#include "profile.h"
+#include "jit.h"
+#include "semantic.h"
+#include "stats.h"
+#include "wide_eval.h"
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_map>
 
 enum StmtType { STMT_INPUT, STMT_OUTPUT, STMT_ASSIGN };
 enum PrimaryKind { VAR, TERM_LIST };
@@ -33,6 +48,7 @@ struct term_t {
 };
 
 enum OperatorType { OP_PLUS, OP_MINUS, OP_NONE };
+enum ArithMode { ARITH_INT, ARITH_CHECKED, ARITH_MOD };
 
 struct term_list_t {
   term_t* term;
@@ -40,8 +56,28 @@ struct term_list_t {
   term_list_t* next = nullptr;
 };
 
+enum FlatOperand : unsigned char { FLAT_PARAM, FLAT_FREE, FLAT_LIST };
+
+// Structure-of-arrays copy of a polynomial body. Term lists are stored in
+// post-order, so a nested list always comes before the list that uses it
+// and evaluation is a single forward pass over the arrays.
+struct flat_poly_t {
+  std::vector<unsigned int> list_end;     // terms of list k: [list_end[k-1], list_end[k])
+  std::vector<int> coefficient;           // per term
+  std::vector<unsigned char> negate;      // per term
+  std::vector<unsigned int> term_end;     // monomials of term t: [term_end[t-1], term_end[t])
+  std::vector<int> exponent;              // per monomial
+  std::vector<FlatOperand> operand_kind;  // per monomial
+  std::vector<unsigned int> operand;      // parameter, free variable or list index
+  std::vector<std::string> free_vars;     // variables that are not parameters
+  std::vector<int> free_slots;            // their memory locations, -1 if none
+  std::vector<int> wide_index;            // per list: entry of wide, -1 if summed term by term
+  std::vector<wide_list_t> wide;
+};
+
 struct poly_body_t {
   term_list_t* terms;
+  flat_poly_t flat;
 };
 
 struct stmt_t {
@@ -58,34 +94,193 @@ struct poly_eval_t {
     std::vector<std::string> args;
 };
 
+// One POLY declaration as cached by reparse_poly_section(). Lines are
+// relative to the start of text so that a declaration which only moved does
+// not have to be parsed again.
+struct poly_decl_cache_t {
+    std::string text;
+    size_t hash = 0;
+    int first_line = 0;          // line of text[0] in the program
+    NodeArena arena;             // owns body
+    std::string name;
+    std::vector<std::string> params;
+    poly_body_t* body = nullptr;
+    int decl_line = 0;
+    std::vector<int> invalid_lines;
+    int degree = 0;
+};
+
+// A polynomial evaluation in the EXECUTE section, kept for arity checks
+struct poly_call_t {
+    std::string name;
+    size_t arg_count;
+    int line;
+    bool undeclared;
+    bool wrong_arity;
+};
+
+enum InstrKind : unsigned char { INSTR_OUTPUT, INSTR_EVAL, INSTR_EVAL_JIT, INSTR_STMT, INSTR_HALT };
+
+// Argument of a lowered call: a memory location, or a constant if slot < 0
+struct instr_arg_t {
+    int slot;
+    int value;
+};
+
+// Polynomial called from the lowered program, resolved once per run
+struct exec_poly_t {
+    const std::string* name;
+    const flat_poly_t* flat;
+    size_t param_count;
+    jit_fn_t compiled;
+    long long multiplications;
+};
+
+// One statement of the EXECUTE section lowered by lower_program()
+struct instr_t {
+    InstrKind kind;
+    int line_no;
+    union {
+        int var;                        // INSTR_OUTPUT
+        struct {
+            int lhs;
+            unsigned int poly;          // index into exec_polys
+            unsigned int arg_begin;     // index into exec_args
+            unsigned int arg_count;
+        } eval;                         // INSTR_EVAL, INSTR_EVAL_JIT
+        stmt_t* stmt;                   // INSTR_STMT: run by execute_assign()
+    };
+};
+
+// Where a value read by a lowered instruction came from in the run that
+// execute_incremental() recorded
+enum IncrSource : unsigned char { INCR_CONST, INCR_INPUT, INCR_RESULT };
+
+struct incr_source_t {
+    IncrSource kind;
+    int value;      // the constant, an INPUTS index or an instruction index
+};
+
+// Index of a polynomial parameter by name, or -1. Later parameters shadow
+// earlier ones with the same name. Every evaluator (flat arrays, --jit,
+// --emit-cpp, --mod) resolves names through this one definition.
+inline int param_index(const std::vector<std::string>& params, const std::string& name) {
+    for (int i = (int) params.size() - 1; i >= 0; --i) {
+        if (params[i] == name) return i;
+    }
+    return -1;
+}
+
+// Whether an argument of a call is a number rather than a variable name
+inline bool is_literal(const std::string& arg) {
+    return isdigit((unsigned char) arg[0]) || (arg[0] == '-' && arg.length() > 1);
+}
+
+// Thrown where the original driver called exit(): after a syntax error, a
+// semantic error report or a fatal runtime error. Output written so far is
+// part of the result.
+struct parser_exit_t {
+    int status;
+};
+
 class Parser {
   public:
+    Parser() = default;
+    explicit Parser(std::istream& in) : lexer(in) {}
+    Parser(std::istream& in, int lex_threads) : lexer(in, lex_threads) {}
+    Parser(std::istream& in, int lex_threads, bool pipelined) : lexer(in, lex_threads, pipelined) {}
+    explicit Parser(std::vector<Token> tokens) : lexer(std::move(tokens)) {}
+    size_t token_count() const { return lexer.token_count(); }
+
     void parse_program();
+    // Must be called before parse_program(); the INPUTS section may then be omitted
+    bool load_binary_inputs(const std::string& path, std::string& error) {
+        return binary_inputs.open(path, error);
+    }
+    void run_tasks();
+    void compute_degrees();
     void execute_program();
+    // Parameter sweeps (incremental.cc): the first execute_incremental() runs
+    // the program and records what every statement read. Later calls
+    // recompute only the statements that depend on an INPUTS value changed
+    // by set_input() and write the full output again.
+    void set_input(size_t index, int value);
+    void execute_incremental();
+    long long incremental_evaluations = 0;  // polynomial calls made by recorded runs and reruns
     void check_useless_assignments();
+    // Repeats the semantic checks made while parsing with a fresh analyzer,
+    // from the declarations, calls and statements the parser kept. Only
+    // valid before the program runs, since a run may rename variable 0.
+    void recheck_semantics();
+    void emit_cpp(std::ostream& out);
+    // Prints every polynomial multiplied out into monomials (expand.cc)
+    void expand_polys(std::ostream& out);
+    // Incremental mode: replaces the POLY declarations with section_text (the
+    // text between the POLY and EXECUTE keywords, starting on first_line) and
+    // reparses only declarations whose text changed since the last call.
+    // Returns the number of declarations parsed.
+    size_t reparse_poly_section(const std::string& section_text, int first_line);
+    static bool find_poly_section(const std::string& program, size_t& begin, size_t& end, int& first_line);
+    void report_semantic_errors();
     std::set<int> task_numbers;
-    std::set<std::string> initialized_vars;
-    std::vector<int> warning_lines_uninitialized;
-    std::vector<int> useless_assignments;
-    std::vector<int> wrong_arity_lines;
     std::map<std::string, int> poly_degree_table;
+    bool use_jit = false;
+    int parse_threads = 1;
+    ArithMode arith_mode = ARITH_INT;
+    long long checked_promotions = 0;   // ARITH_CHECKED statements that needed BigInt
+    Montgomery mont;    // modulus for ARITH_MOD
+    // Single-parameter polynomials of large degree evaluated at many points
+    // go through a subproduct tree unless use_multipoint is cleared
+    std::vector<uint64_t> evaluate_poly_mod_batch(const std::string& poly_name,
+                                                  const std::vector<std::vector<long long>>& args);
+    bool use_multipoint = true;
+    // SIMD kernel for wide term lists; WIDE_OFF sums them term by term
+    WideKernel wide_kernel = WIDE_AUTO;
+    std::ostream* out = &std::cout;
+    bool binary_output = false;
+    RunStats* stats = nullptr;
+    Profiler* profiler = nullptr;
+    void collect_ast_stats();
+    void begin_phase(const char* name) { if (stats) stats->begin_phase(name); }
+    void end_phase() { if (stats) stats->end_phase(); }
 
 
   private:
+    NodeArena arena;
+    NodeArena* node_arena = &arena;
     LexicalAnalyzer lexer;
     void syntax_error();
     Token expect(TokenType expected_type);
+    int expect_int();
 
     // ====== Internal state for semantic checks ======
     std::map<std::string, std::vector<int>> poly_decl_lines;
+    SemanticAnalyzer semantic;
     std::string current_poly;
     std::map<std::string, std::vector<std::string>> poly_params;
-    std::vector<int> invalid_lines;
-    std::vector<int> undeclared_eval_lines;
+    bool arity_mismatch(const std::string& poly_name, size_t arg_count);
+    void report_poly_errors();
+    void report_execute_errors();
+    // ====== Parallel POLY parsing (--parse-threads) ======
+    std::vector<std::unique_ptr<NodeArena>> chunk_arenas;
+    bool parse_poly_decl_list_parallel();
+    // ====== Incremental reparse of the POLY section ======
+    std::vector<std::unique_ptr<poly_decl_cache_t>> poly_decl_cache;
+    bool poly_cache_primed = false;
+    std::vector<poly_call_t> poly_calls;
+    std::map<std::string, std::vector<size_t>> poly_calls_by_name;
+    int execute_line = 0;
+    void shift_execute_lines(int delta);
+    std::unique_ptr<poly_decl_cache_t> parse_cached_decl(const std::string& text);
     // ====== Memory and Execution State for Task 2 ======
-    std::map<std::string, int> location_table;
+    std::map<std::string, int> location_table;      // variable name -> variable id
+    std::vector<std::string> variable_names;         // variable id -> name
+    bool first_variable_renamed = false;             // by argument_id()
+    int variable_id(const std::string& name);
     std::vector<int> memory = std::vector<int>(1000);
     std::vector<int> input_values;
+    MappedInputs binary_inputs;
+    int input_value(size_t i) const;
     int next_available = 0;
     int next_input = 0;
     stmt_t* stmt_list_head = nullptr;
@@ -93,6 +288,64 @@ class Parser {
     bool in_inputs_section = false;
     std::map<std::string, poly_body_t*> poly_bodies;
     std::vector<std::string> input_vars_in_order;
+    int argument_id(const std::string& name);
+    void execute_assign(stmt_t* stmt);
+    void prepare_execution();
+    // ====== Execution frame (frame.cc) ======
+    std::vector<int> frame;     // variable id -> memory slot
+    int frame_size = 0;
+    void allocate_frame();
+    int frame_slot(const std::string& name) const;
+    // ====== Lowered EXECUTE program (exec_program.cc) ======
+    std::vector<instr_t> program;
+    std::vector<instr_arg_t> exec_args;
+    std::vector<exec_poly_t> exec_polys;
+    void lower_program();
+    bool lower_assign(stmt_t* stmt, instr_t& instr, std::unordered_map<std::string, unsigned int>& poly_index);
+    void run_program(OutputWriter& writer);
+    // ====== Incremental re-execution (incremental.cc) ======
+    bool incremental_ready = false;
+    bool inputs_edited = false;                     // input_values overrides binary_inputs
+    std::vector<size_t> edited_inputs;
+    std::vector<int> incr_inputs;                   // INPUTS values of the recorded run
+    std::vector<int> incr_value;                    // per instruction: value stored or printed
+    std::vector<unsigned int> incr_source_begin;    // per instruction: its reads in incr_sources
+    std::vector<incr_source_t> incr_sources;
+    std::vector<std::vector<unsigned int>> incr_input_users;   // instructions reading each input
+    std::vector<std::vector<unsigned int>> incr_result_users;  // instructions reading each result
+    std::vector<unsigned int> incr_outputs;
+    std::vector<char> incr_queued;
+    int incr_source_value(const incr_source_t& source) const;
+    void record_incremental(OutputWriter& writer);
+    void rerun_incremental(OutputWriter& writer);
+    // ====== Native code tier (--jit) ======
+    PolyJit jit;
+    std::map<std::string, jit_fn_t> jit_table;
+    void compile_jit_table();
+    // ====== Overflow-checked evaluation (--arith=checked) ======
+    std::vector<long long> memory64;
+    std::map<int, BigInt> big_memory;
+    std::vector<long long> checked_args;
+    std::vector<long long> checked_lists;           // per list of the body being evaluated
+    void execute_program_checked();
+    void checked_statement(stmt_t* current);
+    void checked_assign(int lhs, const flat_poly_t& flat, const instr_arg_t* arg, unsigned int arg_count);
+    bool checked_eval(const flat_poly_t& flat, const long long* args, long long& result);
+    BigInt big_eval(const flat_poly_t& flat, const std::vector<BigInt>& args);
+    BigInt big_value(int slot);
+    // ====== Modular evaluation (--mod P) ======
+    std::vector<uint64_t> mod_memory;
+    void execute_program_mod();
+    uint64_t mod_eval(term_list_t* term_list, const std::vector<std::string>& params, const uint64_t* args);
+    void mod_eval_batch(term_list_t* term_list, const std::vector<std::string>& params,
+                        const std::vector<std::vector<uint64_t>>& args, size_t lanes, std::vector<uint64_t>& result);
+    bool expand_mod(const flat_poly_t& flat, size_t max_degree, std::vector<uint64_t>& coefficients);
+    void multipoint_eval(const std::vector<uint64_t>& f, const std::vector<uint64_t>& points, std::vector<uint64_t>& result);
+    void multipoint_eval_group(const std::vector<uint64_t>& f, const std::vector<uint64_t>& points,
+                               size_t begin, size_t end, std::vector<uint64_t>& result);
+    // ====== Instrumentation (--stats) ======
+    std::map<std::string, long long> poly_mult_count;
+    long long count_multiplications(const flat_poly_t& flat);
 
     // ====== Parser methods ======
     void parse_tasks_section();
@@ -122,15 +375,17 @@ class Parser {
     std::vector<std::string> parse_argument_list();
     void parse_argument(std::vector<std::string>& args);
     void parse_inputs_section();
-    int evaluate_poly(poly_body_t* body, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table);
-    int evaluate_term(term_t* term, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table);
-    int evaluate_monomial(monomial_t* monomial, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table);
-    int evaluate_primary(primary_t* primary, const std::map<std::string, int>& arg_values, const std::map<std::string, int>& location_table);
-    int get_degree(term_list_t* term_list);
-    int get_degree(term_t* term);
-    int get_degree(const std::vector<monomial_t*>& monomial_list);
-    int get_degree(monomial_t* monomial);
-    int get_degree(primary_t* primary);
+    // ====== Flat polynomial representation (flat_poly.cc) ======
+    std::vector<int> arg_buffer;
+    std::vector<unsigned int> list_values;
+    std::vector<uint32_t> wide_table;
+    unsigned int evaluate_wide(const flat_poly_t& flat, const wide_list_t& wide, const int* args);
+    void flatten_poly(poly_body_t* body, const std::vector<std::string>& params);
+    unsigned int flatten_list(term_list_t* term_list, const std::vector<std::string>& params, flat_poly_t& flat,
+                              std::unordered_map<term_list_t*, unsigned int>& flattened);
+    void resolve_free_vars();
+    int evaluate_flat(const flat_poly_t& flat, const int* args);
+    int get_degree(const flat_poly_t& flat);
 };
 
 #endif
@@ -0,0 +1,175 @@
+/*
+ * Dense polynomial multiplication modulo 2^32.
+ *
+ * The NTT path convolves modulo three NTT-friendly primes whose product
+ * (about 2^86) exceeds every coefficient of the exact integer product as
+ * long as the shorter operand has at most 2^21 coefficients; Garner's
+ * algorithm then rebuilds each coefficient modulo 2^32. Longer operands
+ * are multiplied in pieces of that length.
+ */
+#include <algorithm>
+#include <cstdint>
+
+#include "polyarith.h"
+
+using namespace std;
+
+namespace {
+
+const size_t NTT_CUTOFF = 4096;         // shorter operand length
+const size_t NTT_MAX_OPERAND = 1 << 21; // CRT bound, see above
+
+// Every prime has 3 as a primitive root
+constexpr uint32_t NTT_PRIMES[3] = {
+    998244353,      // 119 * 2^23 + 1
+    167772161,      // 5 * 2^25 + 1
+    469762049,      // 7 * 2^26 + 1
+};
+const int NTT_MAX_LOG = 23;
+
+uint32_t pow_mod(uint32_t base, uint64_t exponent, uint32_t p) {
+    uint64_t result = 1;
+    uint64_t b = base;
+    while (exponent != 0) {
+        if (exponent & 1) result = result * b % p;
+        b = b * b % p;
+        exponent >>= 1;
+    }
+    return (uint32_t) result;
+}
+
+// The prime is a template argument so every reduction is by a constant
+template <uint32_t P>
+void ntt(vector<uint32_t>& a, bool invert) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) swap(a[i], a[j]);
+    }
+    vector<uint32_t> roots;
+    for (size_t len = 2; len <= n; len <<= 1) {
+        uint32_t w = pow_mod(3, (P - 1) / len, P);
+        if (invert) w = pow_mod(w, P - 2, P);
+        size_t half = len / 2;
+        roots.resize(half);
+        roots[0] = 1;
+        for (size_t k = 1; k < half; k++) {
+            roots[k] = (uint32_t) ((uint64_t) roots[k - 1] * w % P);
+        }
+        for (size_t i = 0; i < n; i += len) {
+            uint32_t* lo = &a[i];
+            uint32_t* hi = &a[i + half];
+            for (size_t k = 0; k < half; k++) {
+                uint32_t u = lo[k];
+                uint32_t v = (uint32_t) ((uint64_t) hi[k] * roots[k] % P);
+                lo[k] = (u + v >= P) ? u + v - P : u + v;
+                hi[k] = (u >= v) ? u - v : u + P - v;
+            }
+        }
+    }
+    if (invert) {
+        uint64_t n_inv = pow_mod((uint32_t) (n % P), P - 2, P);
+        for (uint32_t& x : a) {
+            x = (uint32_t) (x * n_inv % P);
+        }
+    }
+}
+
+template <uint32_t P>
+vector<uint32_t> convolve_mod(const dense_poly_t& a, const dense_poly_t& b, size_t size) {
+    vector<uint32_t> fa(size, 0);
+    vector<uint32_t> fb(size, 0);
+    for (size_t i = 0; i < a.size(); i++) fa[i] = a[i] % P;
+    for (size_t i = 0; i < b.size(); i++) fb[i] = b[i] % P;
+    ntt<P>(fa, false);
+    ntt<P>(fb, false);
+    for (size_t i = 0; i < size; i++) {
+        fa[i] = (uint32_t) ((uint64_t) fa[i] * fb[i] % P);
+    }
+    ntt<P>(fa, true);
+    return fa;
+}
+
+dense_poly_t ntt_mul(const dense_poly_t& a, const dense_poly_t& b) {
+    size_t result_size = a.size() + b.size() - 1;
+    size_t size = 1;
+    while (size < result_size) size <<= 1;
+
+    const uint64_t p1 = NTT_PRIMES[0];
+    const uint64_t p2 = NTT_PRIMES[1];
+    const uint64_t p3 = NTT_PRIMES[2];
+    vector<uint32_t> r1 = convolve_mod<NTT_PRIMES[0]>(a, b, size);
+    vector<uint32_t> r2 = convolve_mod<NTT_PRIMES[1]>(a, b, size);
+    vector<uint32_t> r3 = convolve_mod<NTT_PRIMES[2]>(a, b, size);
+    const uint64_t p1_inv_p2 = pow_mod((uint32_t) (p1 % p2), p2 - 2, (uint32_t) p2);
+    const uint64_t p12_inv_p3 = pow_mod((uint32_t) (p1 * p2 % p3), p3 - 2, (uint32_t) p3);
+
+    dense_poly_t result(result_size);
+    for (size_t i = 0; i < result_size; i++) {
+        // x = x1 + x2 p1 + x3 p1 p2 with each digit below its prime
+        uint64_t x1 = r1[i];
+        uint64_t x2 = (r2[i] + p2 - x1 % p2) % p2 * p1_inv_p2 % p2;
+        uint64_t x12_mod_p3 = (x1 + x2 * p1) % p3;
+        uint64_t x3 = (r3[i] + p3 - x12_mod_p3) % p3 * p12_inv_p3 % p3;
+        result[i] = (uint32_t) x1 + (uint32_t) x2 * (uint32_t) p1 + (uint32_t) x3 * (uint32_t) (p1 * p2);
+    }
+    return result;
+}
+
+}  // namespace
+
+void poly_trim(dense_poly_t& a) {
+    while (!a.empty() && a.back() == 0) a.pop_back();
+}
+
+dense_poly_t poly_mul(const dense_poly_t& a, const dense_poly_t& b, PolyMulMethod method) {
+    if (a.empty() || b.empty()) return dense_poly_t();
+    size_t shorter = min(a.size(), b.size());
+    if (method == POLY_MUL_AUTO) {
+        if (shorter < KARATSUBA_CUTOFF) {
+            method = POLY_MUL_SCHOOLBOOK;
+        } else if (shorter < NTT_CUTOFF || a.size() + b.size() - 1 > ((size_t) 1 << NTT_MAX_LOG)) {
+            method = POLY_MUL_KARATSUBA;
+        } else {
+            method = POLY_MUL_NTT;
+        }
+    }
+    if (method == POLY_MUL_NTT) {
+        if (shorter <= NTT_MAX_OPERAND) return ntt_mul(a, b);
+        const dense_poly_t& longer = (a.size() >= b.size()) ? a : b;
+        const dense_poly_t& other = (a.size() >= b.size()) ? b : a;
+        dense_poly_t result(a.size() + b.size() - 1, 0);
+        for (size_t offset = 0; offset < other.size(); offset += NTT_MAX_OPERAND) {
+            size_t len = min(NTT_MAX_OPERAND, other.size() - offset);
+            dense_poly_t piece(other.begin() + offset, other.begin() + offset + len);
+            dense_poly_t partial = ntt_mul(longer, piece);
+            for (size_t i = 0; i < partial.size(); i++) {
+                result[offset + i] += partial[i];
+            }
+        }
+        return result;
+    }
+
+    wrap32_ring_t ring;
+    dense_poly_t result(a.size() + b.size() - 1, 0);
+    if (method == POLY_MUL_SCHOOLBOOK) {
+        schoolbook_mul_add(ring, a.data(), a.size(), b.data(), b.size(), result.data());
+    } else {
+        karatsuba_mul_add(ring, a.data(), a.size(), b.data(), b.size(), result.data());
+    }
+    return result;
+}
+
+dense_poly_t poly_pow(const dense_poly_t& base, unsigned int exponent) {
+    dense_poly_t result = {1};
+    dense_poly_t square = base;
+    while (exponent != 0) {
+        if (exponent & 1) result = poly_mul(result, square);
+        exponent >>= 1;
+        if (exponent != 0) square = poly_mul(square, square);
+    }
+    poly_trim(result);
+    return result;
+}
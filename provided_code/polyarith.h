@@ -0,0 +1,106 @@
+/*
+ * Dense univariate polynomial multiplication.
+ *
+ * poly_mul() picks schoolbook multiplication for short operands, Karatsuba
+ * in the middle range and, for coefficients modulo 2^32, a three-prime NTT
+ * with CRT reconstruction for long ones. Karatsuba is a template over a
+ * small ring type so the --mod code can reuse it with Montgomery
+ * arithmetic. Multivariate products go through Kronecker substitution in
+ * the callers (see expand.cc).
+ */
+#ifndef __POLYARITH_H__
+#define __POLYARITH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Coefficient i belongs to y^i; arithmetic wraps modulo 2^32
+typedef std::vector<uint32_t> dense_poly_t;
+
+// The ring int evaluation already works in
+struct wrap32_ring_t {
+    typedef uint32_t value_t;
+    uint32_t zero() const { return 0; }
+    uint32_t add(uint32_t a, uint32_t b) const { return a + b; }
+    uint32_t sub(uint32_t a, uint32_t b) const { return a - b; }
+    uint32_t mul(uint32_t a, uint32_t b) const { return a * b; }
+};
+
+const size_t KARATSUBA_CUTOFF = 32;
+
+// out[0, n + m - 1) += a[0, n) * b[0, m), quadratic
+template <typename Ring>
+void schoolbook_mul_add(const Ring& ring, const typename Ring::value_t* a, size_t n,
+                        const typename Ring::value_t* b, size_t m, typename Ring::value_t* out)
+{
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < m; j++) {
+            out[i + j] = ring.add(out[i + j], ring.mul(a[i], b[j]));
+        }
+    }
+}
+
+// out[0, n + m - 1) += a[0, n) * b[0, m). Unbalanced operands are cut into
+// pieces as long as the shorter one.
+template <typename Ring>
+void karatsuba_mul_add(const Ring& ring, const typename Ring::value_t* a, size_t n,
+                       const typename Ring::value_t* b, size_t m, typename Ring::value_t* out)
+{
+    typedef typename Ring::value_t value_t;
+    if (n < m) {
+        karatsuba_mul_add(ring, b, m, a, n, out);
+        return;
+    }
+    if (m == 0) return;
+    if (m < KARATSUBA_CUTOFF) {
+        schoolbook_mul_add(ring, a, n, b, m, out);
+        return;
+    }
+    if (n > m) {
+        for (size_t offset = 0; offset < n; offset += m) {
+            size_t len = (n - offset < m) ? n - offset : m;
+            karatsuba_mul_add(ring, a + offset, len, b, m, out + offset);
+        }
+        return;
+    }
+
+    // a = a0 + y^h a1, b = b0 + y^h b1 and
+    // a b = a0 b0 + y^h ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) + y^2h a1 b1
+    size_t h = n / 2;
+    size_t high = n - h;
+    std::vector<value_t> low_product(2 * h - 1, ring.zero());
+    std::vector<value_t> high_product(2 * high - 1, ring.zero());
+    std::vector<value_t> a_sum(a + h, a + n);
+    std::vector<value_t> b_sum(b + h, b + n);
+    for (size_t i = 0; i < h; i++) {
+        a_sum[i] = ring.add(a_sum[i], a[i]);
+        b_sum[i] = ring.add(b_sum[i], b[i]);
+    }
+    std::vector<value_t> middle(2 * high - 1, ring.zero());
+    karatsuba_mul_add(ring, a, h, b, h, low_product.data());
+    karatsuba_mul_add(ring, a + h, high, b + h, high, high_product.data());
+    karatsuba_mul_add(ring, a_sum.data(), high, b_sum.data(), high, middle.data());
+    for (size_t i = 0; i < low_product.size(); i++) {
+        middle[i] = ring.sub(middle[i], low_product[i]);
+        out[i] = ring.add(out[i], low_product[i]);
+    }
+    for (size_t i = 0; i < high_product.size(); i++) {
+        middle[i] = ring.sub(middle[i], high_product[i]);
+        out[2 * h + i] = ring.add(out[2 * h + i], high_product[i]);
+    }
+    for (size_t i = 0; i < middle.size(); i++) {
+        out[h + i] = ring.add(out[h + i], middle[i]);
+    }
+}
+
+enum PolyMulMethod { POLY_MUL_AUTO, POLY_MUL_SCHOOLBOOK, POLY_MUL_KARATSUBA, POLY_MUL_NTT };
+
+// a * b modulo 2^32; POLY_MUL_AUTO chooses by operand length
+dense_poly_t poly_mul(const dense_poly_t& a, const dense_poly_t& b, PolyMulMethod method = POLY_MUL_AUTO);
+// base^exponent by repeated squaring; base^0 is 1
+dense_poly_t poly_pow(const dense_poly_t& base, unsigned int exponent);
+// Drops trailing zero coefficients
+void poly_trim(dense_poly_t& a);
+
+#endif  //__POLYARITH_H__
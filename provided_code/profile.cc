@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "profile.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+unsigned long long Profiler::now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (unsigned long long) chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void Profiler::record(const string& poly_name, int line, long long multiplications, unsigned long long cycles)
+{
+    for (profile_entry_t* entry : {&polys[poly_name], &lines[line]}) {
+        entry->calls++;
+        entry->cycles += cycles;
+        entry->multiplications += multiplications;
+    }
+    stacks[{line, poly_name}] += cycles;
+}
+
+template <typename K>
+static vector<pair<K, profile_entry_t>> hottest_first(const map<K, profile_entry_t>& entries)
+{
+    vector<pair<K, profile_entry_t>> sorted(entries.begin(), entries.end());
+    stable_sort(sorted.begin(), sorted.end(), [](const pair<K, profile_entry_t>& a, const pair<K, profile_entry_t>& b) {
+        return a.second.cycles > b.second.cycles;
+    });
+    return sorted;
+}
+
+void Profiler::report(ostream& out) const
+{
+    unsigned long long total = 0;
+    for (const auto& entry : polys) {
+        total += entry.second.cycles;
+    }
+    char row[256];
+
+    out << "polynomial              calls           cycles   cycles/call  multiplications      %\n";
+    for (const auto& entry : hottest_first(polys)) {
+        const profile_entry_t& p = entry.second;
+        snprintf(row, sizeof(row), "%-16s %12lld %16llu %13llu %16lld %6.2f\n", entry.first.c_str(), p.calls, p.cycles,
+                 p.cycles / (unsigned long long) max(p.calls, 1LL), p.multiplications, total ? 100.0 * p.cycles / total : 0.0);
+        out << row;
+    }
+
+    out << "line                    calls           cycles   cycles/call  multiplications      %\n";
+    for (const auto& entry : hottest_first(lines)) {
+        const profile_entry_t& p = entry.second;
+        snprintf(row, sizeof(row), "%-16d %12lld %16llu %13llu %16lld %6.2f\n", entry.first, p.calls, p.cycles,
+                 p.cycles / (unsigned long long) max(p.calls, 1LL), p.multiplications, total ? 100.0 * p.cycles / total : 0.0);
+        out << row;
+    }
+}
+
+bool Profiler::write_folded(const string& path) const
+{
+    ofstream out(path);
+    if (!out) return false;
+    for (const auto& entry : stacks) {
+        out << "EXECUTE;line " << entry.first.first << ";" << entry.first.second << " " << entry.second << "\n";
+    }
+    return (bool) out;
+}
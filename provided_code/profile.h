@@ -0,0 +1,36 @@
+/*
+ * Execution profile for --profile: per polynomial and per EXECUTE line
+ * call counts, evaluation cycles and multiplications (counted the way
+ * --stats counts them). Cycles come from the time-stamp counter where the
+ * target has one and from a nanosecond clock otherwise.
+ */
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <map>
+#include <ostream>
+#include <string>
+
+struct profile_entry_t {
+    long long calls = 0;
+    unsigned long long cycles = 0;
+    long long multiplications = 0;
+};
+
+class Profiler {
+  public:
+    static unsigned long long now();
+
+    void record(const std::string& poly_name, int line, long long multiplications, unsigned long long cycles);
+    // Both tables sorted by cycles, hottest first
+    void report(std::ostream& out) const;
+    // One "EXECUTE;line N;POLY cycles" line per call site, for flamegraph.pl
+    bool write_folded(const std::string& path) const;
+
+  private:
+    std::map<std::string, profile_entry_t> polys;
+    std::map<int, profile_entry_t> lines;
+    std::map<std::pair<int, std::string>, unsigned long long> stacks;
+};
+
+#endif  //__PROFILE_H__
@@ -0,0 +1,238 @@
+/*
+ * Incremental reparse of the POLY section.
+ *
+ * The section is split into declarations at ';' (which cannot occur inside
+ * a declaration). Each declaration is cached with its own arena under a hash
+ * of its text, and only declarations whose text is new are parsed again.
+ * Line numbers are stored relative to the declaration so one that merely
+ * moved is reused as is. The name-keyed tables (parameters, bodies,
+ * degrees) and the arity checks of EXECUTE calls are only recomputed for
+ * names whose declarations were added or removed.
+ */
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+
+#include "parser.h"
+
+using namespace std;
+
+// Finds the text between the POLY and EXECUTE keywords of a program
+bool Parser::find_poly_section(const string& program, size_t& begin, size_t& end, int& first_line)
+{
+    begin = string::npos;
+    first_line = 1;
+    int line = 1;
+    size_t i = 0;
+    while (i < program.size()) {
+        char c = program[i];
+        if (c == '\n') line++;
+        if (!isalnum((unsigned char) c)) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < program.size() && isalnum((unsigned char) program[i])) i++;
+        string word = program.substr(start, i - start);
+        if (begin == string::npos && word == "POLY") {
+            begin = i;
+            first_line = line;
+        } else if (begin != string::npos && word == "EXECUTE") {
+            end = start;
+            return true;
+        }
+    }
+    return false;
+}
+
+unique_ptr<poly_decl_cache_t> Parser::parse_cached_decl(const string& text)
+{
+    unique_ptr<poly_decl_cache_t> decl(new poly_decl_cache_t());
+    decl->text = text;
+    decl->hash = hash<string>()(text);
+
+    // The declaration is parsed with the ordinary parse_poly_decl() against
+    // empty tables, so what it records belongs to this declaration only.
+    istringstream in(text);
+    LexicalAnalyzer decl_lexer(in);
+    map<string, vector<int>> decl_lines;
+    map<string, vector<string>> params;
+    map<string, poly_body_t*> bodies;
+    SemanticAnalyzer decl_semantic;
+    auto swap_state = [&] {
+        swap(lexer, decl_lexer);
+        swap(poly_decl_lines, decl_lines);
+        swap(poly_params, params);
+        swap(poly_bodies, bodies);
+        swap(semantic, decl_semantic);
+    };
+
+    swap_state();
+    node_arena = &decl->arena;
+    try {
+        parse_poly_decl();
+        expect(END_OF_FILE);
+    } catch (...) {
+        swap_state();
+        node_arena = &arena;
+        throw;
+    }
+    swap_state();
+    node_arena = &arena;
+
+    decl->name = current_poly;
+    decl->params = params[current_poly];
+    decl->body = bodies[current_poly];
+    decl->decl_line = decl_lines[current_poly].back();
+    decl->invalid_lines = decl_semantic.invalid_vars.values();
+    decl->degree = (decl->body != nullptr) ? get_degree(decl->body->flat) : 0;
+    return decl;
+}
+
+// The EXECUTE section is not reparsed, but its line numbers move when the
+// POLY section gains or loses lines
+void Parser::shift_execute_lines(int delta)
+{
+    if (delta == 0) return;
+    execute_line += delta;
+    for (stmt_t* stmt = stmt_list_head; stmt != nullptr; stmt = stmt->next) {
+        stmt->line_no += delta;
+    }
+    for (poly_call_t& call : poly_calls) {
+        call.line += delta;
+    }
+    semantic.shift_execute_lines(delta);
+}
+
+size_t Parser::reparse_poly_section(const string& section_text, int first_line)
+{
+    unordered_multimap<size_t, size_t> cached;
+    for (size_t i = 0; i < poly_decl_cache.size(); i++) {
+        cached.insert({poly_decl_cache[i]->hash, i});
+    }
+
+    // Nothing is taken out of the cache until every changed declaration has
+    // parsed, so a syntax error leaves the previous state intact.
+    struct slot_t {
+        size_t cached_index;
+        unique_ptr<poly_decl_cache_t> parsed;
+        int first_line;
+    };
+    vector<slot_t> slots;
+    set<string> touched;
+    size_t parsed = 0;
+    int line = first_line;
+    size_t pos = 0;
+    while (true) {
+        while (pos < section_text.size() && isspace((unsigned char) section_text[pos])) {
+            if (section_text[pos] == '\n') line++;
+            pos++;
+        }
+        if (pos == section_text.size()) break;
+
+        size_t start = pos;
+        int start_line = line;
+        while (pos < section_text.size() && section_text[pos] != ';') {
+            if (section_text[pos] == '\n') line++;
+            pos++;
+        }
+        if (pos < section_text.size()) pos++;
+        string text = section_text.substr(start, pos - start);
+
+        slot_t slot = {SIZE_MAX, nullptr, start_line};
+        auto range = cached.equal_range(hash<string>()(text));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (poly_decl_cache[it->second]->text == text) {
+                slot.cached_index = it->second;
+                cached.erase(it);
+                break;
+            }
+        }
+        if (slot.cached_index == SIZE_MAX) {
+            slot.parsed = parse_cached_decl(text);
+            touched.insert(slot.parsed->name);
+            parsed++;
+        }
+        slots.push_back(std::move(slot));
+    }
+
+    vector<unique_ptr<poly_decl_cache_t>> decls;
+    for (slot_t& slot : slots) {
+        unique_ptr<poly_decl_cache_t> decl = slot.parsed ? std::move(slot.parsed)
+                                                         : std::move(poly_decl_cache[slot.cached_index]);
+        decl->first_line = slot.first_line;
+        decls.push_back(std::move(decl));
+    }
+
+    shift_execute_lines(line - execute_line);
+
+    // Whatever is left in the cache was edited away
+    for (const auto& entry : cached) {
+        touched.insert(poly_decl_cache[entry.second]->name);
+    }
+    if (!poly_cache_primed) {
+        // The tables still describe the declarations seen by parse_program()
+        for (const auto& entry : poly_params) {
+            touched.insert(entry.first);
+        }
+        poly_cache_primed = true;
+    }
+    poly_decl_cache = std::move(decls);
+
+    // Line-based tables shift with every edit, so they are rebuilt
+    poly_decl_lines.clear();
+    semantic.clear_declarations();
+    map<string, poly_decl_cache_t*> last_decl;
+    for (const unique_ptr<poly_decl_cache_t>& decl : poly_decl_cache) {
+        int offset = decl->first_line - 1;
+        poly_decl_lines[decl->name].push_back(decl->decl_line + offset);
+        semantic.declare_poly(decl->name, decl->decl_line + offset);
+        for (int invalid : decl->invalid_lines) {
+            semantic.invalid_variable(invalid + offset);
+        }
+        last_decl[decl->name] = decl.get();
+    }
+
+    for (const string& name : touched) {
+        auto last = last_decl.find(name);
+        if (last != last_decl.end()) {
+            poly_params[name] = last->second->params;
+            poly_bodies[name] = last->second->body;
+            poly_degree_table[name] = last->second->degree;
+        } else {
+            poly_params.erase(name);
+            poly_bodies.erase(name);
+            poly_degree_table.erase(name);
+        }
+
+        auto calls = poly_calls_by_name.find(name);
+        if (calls == poly_calls_by_name.end()) continue;
+        for (size_t index : calls->second) {
+            poly_call_t& call = poly_calls[index];
+            bool undeclared = (last == last_decl.end());
+            if (undeclared != call.undeclared) {
+                if (undeclared) {
+                    semantic.undeclared_call(call.line);
+                } else {
+                    semantic.undeclared_calls.remove(call.line);
+                }
+                call.undeclared = undeclared;
+            }
+            bool wrong_arity = arity_mismatch(name, call.arg_count);
+            if (wrong_arity != call.wrong_arity) {
+                if (wrong_arity) {
+                    semantic.add_wrong_arity(call.line);
+                } else {
+                    semantic.remove_wrong_arity(call.line);
+                }
+                call.wrong_arity = wrong_arity;
+            }
+        }
+    }
+    // recorded dependencies refer to the old bodies
+    incremental_ready = false;
+    return parsed;
+}
@@ -0,0 +1,120 @@
+/*
+ * Semantic errors and warnings, collected while the program is parsed.
+ */
+#include <algorithm>
+
+#include "parser.h"
+#include "semantic.h"
+
+using namespace std;
+
+// Marks a pending entry whose assignment has been read
+static const size_t NOT_PENDING = (size_t) -1;
+
+void LineBucket::add(int line) {
+    if (lines.empty() || lines.back() <= line) {
+        lines.push_back(line);
+    } else {
+        // a call nested in the arguments of a call on an earlier line
+        lines.insert(upper_bound(lines.begin(), lines.end(), line), line);
+    }
+}
+
+void LineBucket::remove(int line) {
+    auto found = lower_bound(lines.begin(), lines.end(), line);
+    if (found != lines.end() && *found == line) lines.erase(found);
+}
+
+void LineBucket::shift(int delta) {
+    for (int& line : lines) line += delta;
+}
+
+void print_lines(ostream& out, const char* label, const LineBucket& lines) {
+    out << label << ":";
+    for (int line : lines) {
+        out << " " << line;
+    }
+    out << endl;
+}
+
+// ====== POLY section ======
+void SemanticAnalyzer::declare_poly(const string& name, int line) {
+    if (!declared.insert(name).second) duplicate_decls.add(line);
+    declarations.push_back({name, line});
+}
+
+void SemanticAnalyzer::clear_declarations() {
+    duplicate_decls.clear();
+    invalid_vars.clear();
+    declared.clear();
+    declarations.clear();
+}
+
+void SemanticAnalyzer::merge_declarations(const SemanticAnalyzer& later) {
+    for (const auto& declaration : later.declarations) {
+        declare_poly(declaration.first, declaration.second);
+    }
+    for (int line : later.invalid_vars) {
+        invalid_vars.add(line);
+    }
+}
+
+// ====== EXECUTE section ======
+// A line is listed once however many of its calls have a wrong count
+void SemanticAnalyzer::add_wrong_arity(int line) {
+    if (wrong_arity_calls[line]++ == 0) wrong_arity_lines.add(line);
+}
+
+void SemanticAnalyzer::remove_wrong_arity(int line) {
+    if (--wrong_arity_calls[line] == 0) wrong_arity_lines.remove(line);
+}
+
+void SemanticAnalyzer::assign(const string& lhs, const vector<string>& args, int line, bool check_uninitialized) {
+    bool reads_lhs = false;
+    for (const string& arg : args) {
+        if (check_uninitialized && initialized.count(arg) == 0) {
+            uninitialized_args.add(line);
+        }
+        if (is_literal(arg)) continue;
+        if (arg == lhs) {
+            reads_lhs = true;
+            continue;
+        }
+        auto read = pending.find(arg);
+        if (read != pending.end()) read->second = NOT_PENDING;
+    }
+    initialized.insert(lhs);
+
+    auto entry = pending.emplace(lhs, NOT_PENDING).first;
+    if (entry->second != NOT_PENDING) {
+        // assigned again before anything read it
+        useless[entry->second] = 1;
+    }
+    entry->second = reads_lhs ? NOT_PENDING : assign_lines.size();
+    assign_lines.push_back(line);
+    useless.push_back(0);
+}
+
+void SemanticAnalyzer::finish_assignments() {
+    vector<char> flags = useless;
+    for (const auto& entry : pending) {
+        if (entry.second != NOT_PENDING && outputs.count(entry.first) == 0) flags[entry.second] = 1;
+    }
+    useless_assignments.clear();
+    for (size_t i = 0; i < flags.size(); i++) {
+        if (flags[i]) useless_assignments.add(assign_lines[i]);
+    }
+}
+
+void SemanticAnalyzer::shift_execute_lines(int delta) {
+    undeclared_calls.shift(delta);
+    wrong_arity_lines.shift(delta);
+    uninitialized_args.shift(delta);
+    useless_assignments.shift(delta);
+    for (int& line : assign_lines) line += delta;
+    unordered_map<int, int> shifted;
+    for (const auto& entry : wrong_arity_calls) {
+        shifted[entry.first + delta] = entry.second;
+    }
+    wrong_arity_calls.swap(shifted);
+}
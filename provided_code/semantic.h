@@ -0,0 +1,90 @@
+/*
+ * Semantic errors and warnings, collected while the program is parsed.
+ *
+ * The parser hands every declaration, invalid variable, call, INPUT,
+ * OUTPUT and assignment to the SemanticAnalyzer as it reads it, so all
+ * error codes and warnings come out of the one traversal that builds the
+ * AST. Lines are kept in LineBuckets, which stay sorted as lines are added;
+ * since the parser moves forward through the source, adding is almost
+ * always an append and nothing is sorted before it is printed.
+ *
+ * Warning Code 2 is decided forwards: an assignment stays pending until
+ * its variable is read by another statement (not used) or assigned again
+ * first (useless). Assignments still pending at the end are useless unless
+ * the variable appears in some OUTPUT statement. A statement that reads
+ * the variable it assigns is never useless, but that read does not count
+ * as a use of the assignment before it.
+ */
+#ifndef __SEMANTIC_H__
+#define __SEMANTIC_H__
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Line numbers in ascending order, duplicates included
+class LineBucket {
+  public:
+    void add(int line);
+    // Removes one occurrence of line, if there is one
+    void remove(int line);
+    void shift(int delta);
+    void clear() { lines.clear(); }
+    bool empty() const { return lines.empty(); }
+    size_t size() const { return lines.size(); }
+    const std::vector<int>& values() const { return lines; }
+    std::vector<int>::const_iterator begin() const { return lines.begin(); }
+    std::vector<int>::const_iterator end() const { return lines.end(); }
+
+  private:
+    std::vector<int> lines;
+};
+
+// Prints "label: l1 l2 ..." on one line
+void print_lines(std::ostream& out, const char* label, const LineBucket& lines);
+
+class SemanticAnalyzer {
+  public:
+    // ====== POLY section ======
+    void declare_poly(const std::string& name, int line);
+    bool is_declared(const std::string& name) const { return declared.count(name) != 0; }
+    void invalid_variable(int line) { invalid_vars.add(line); }
+    // Drops what declare_poly() and invalid_variable() recorded
+    void clear_declarations();
+    // Appends the declarations of a later part of the POLY section
+    void merge_declarations(const SemanticAnalyzer& later);
+
+    // ====== EXECUTE section ======
+    void undeclared_call(int line) { undeclared_calls.add(line); }
+    void add_wrong_arity(int line);
+    void remove_wrong_arity(int line);
+    void input(const std::string& var) { initialized.insert(var); }
+    void output(const std::string& var) { outputs.insert(var); }
+    void assign(const std::string& lhs, const std::vector<std::string>& args, int line, bool check_uninitialized);
+    // Fills useless_assignments from the assignments seen so far
+    void finish_assignments();
+    void shift_execute_lines(int delta);
+
+    LineBucket duplicate_decls;         // Semantic Error Code 1
+    LineBucket invalid_vars;            // Semantic Error Code 2
+    LineBucket undeclared_calls;        // Semantic Error Code 3
+    LineBucket wrong_arity_lines;       // Semantic Error Code 4
+    LineBucket uninitialized_args;      // Warning Code 1
+    LineBucket useless_assignments;     // Warning Code 2
+
+  private:
+    std::unordered_set<std::string> declared;
+    std::vector<std::pair<std::string, int>> declarations;  // in source order
+    std::unordered_map<int, int> wrong_arity_calls;         // line -> calls with a wrong count
+    std::unordered_set<std::string> initialized;
+    std::unordered_set<std::string> outputs;
+    std::vector<int> assign_lines;                          // per assignment, in source order
+    std::vector<char> useless;                              // per assignment
+    std::unordered_map<std::string, size_t> pending;        // variable -> assignment not yet read
+};
+
+#endif  //__SEMANTIC_H__
@@ -0,0 +1,168 @@
+/*
+ * Run statistics for --stats.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+
+#include "stats.h"
+
+using namespace std;
+
+// ====== Heap allocation counting ======
+// Off unless --stats asked for it, so a plain run pays one load per new
+static atomic<bool> counting(false);
+static atomic<long long> allocation_count(0);
+static atomic<long long> allocation_bytes(0);
+
+void* operator new(size_t size)
+{
+    if (counting.load(memory_order_relaxed)) {
+        allocation_count.fetch_add(1, memory_order_relaxed);
+        allocation_bytes.fetch_add((long long) size, memory_order_relaxed);
+    }
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void count_heap_allocations()
+{
+    counting.store(true, memory_order_relaxed);
+}
+
+long long heap_allocation_count()
+{
+    return allocation_count.load(memory_order_relaxed);
+}
+
+long long heap_allocation_bytes()
+{
+    return allocation_bytes.load(memory_order_relaxed);
+}
+
+// ====== Phases ======
+static long long now_ns()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+size_t RunStats::phase_index(const string& name)
+{
+    for (size_t i = 0; i < phases.size(); i++) {
+        if (phases[i].name == name) return i;
+    }
+    phases.push_back(phase_stat_t());
+    phases.back().name = name;
+    return phases.size() - 1;
+}
+
+void RunStats::charge(open_phase_t& phase)
+{
+    long long t = now_ns();
+    long long a = heap_allocation_count();
+    phases[phase.index].wall_ns += t - phase.resumed_ns;
+    phases[phase.index].allocations += a - phase.resumed_allocations;
+    phase.resumed_ns = t;
+    phase.resumed_allocations = a;
+}
+
+void RunStats::begin_phase(const string& name)
+{
+    if (!open.empty()) {
+        charge(open.back());
+    }
+    open.push_back({phase_index(name), now_ns(), heap_allocation_count()});
+}
+
+void RunStats::end_phase()
+{
+    if (open.empty()) return;
+    charge(open.back());
+    phase_stat_t& phase = phases[open.back().index];
+    phase.peak_rss_kb = max(phase.peak_rss_kb, peak_rss_kb());
+    open.pop_back();
+    if (!open.empty()) {
+        open.back().resumed_ns = now_ns();
+        open.back().resumed_allocations = heap_allocation_count();
+    }
+}
+
+void RunStats::report(ostream& out, bool json)
+{
+    // a semantic error exits in the middle of a phase; close what is open
+    while (!open.empty()) {
+        end_phase();
+    }
+
+    if (json) {
+        out << "{\n  \"phases\": [\n";
+        for (size_t i = 0; i < phases.size(); i++) {
+            out << "    {\"name\": \"" << phases[i].name << "\", \"wall_ns\": " << phases[i].wall_ns
+                << ", \"allocations\": " << phases[i].allocations
+                << ", \"peak_rss_kb\": " << phases[i].peak_rss_kb << "}"
+                << (i + 1 < phases.size() ? "," : "") << "\n";
+        }
+        out << "  ],\n  \"tokens\": " << tokens << ",\n  \"ast_nodes\": {";
+        for (auto it = node_counts.begin(); it != node_counts.end(); ++it) {
+            out << (it == node_counts.begin() ? "" : ", ") << "\"" << it->first << "\": " << it->second;
+        }
+        out << "},\n"
+            << "  \"heap_allocations\": " << heap_allocation_count() << ",\n"
+            << "  \"heap_bytes\": " << heap_allocation_bytes() << ",\n"
+            << "  \"poly_evaluations\": " << poly_evaluations << ",\n"
+            << "  \"multiplications\": " << multiplications << ",\n"
+            << "  \"interned_nodes\": " << interned_nodes << ",\n"
+            << "  \"unique_nodes\": " << unique_nodes << ",\n"
+            << "  \"variables\": " << variables << ",\n"
+            << "  \"frame_slots\": " << frame_slots << "\n"
+            << "}\n";
+        return;
+    }
+
+    out << "phase          wall_ms   allocations  peak_rss_kb\n";
+    for (const phase_stat_t& phase : phases) {
+        char line[128];
+        snprintf(line, sizeof(line), "%-12s %9.3f %13lld %12ld\n", phase.name.c_str(),
+                 phase.wall_ns / 1e6, phase.allocations, phase.peak_rss_kb);
+        out << line;
+    }
+    out << "tokens: " << tokens << "\n";
+    out << "ast nodes:";
+    for (const auto& entry : node_counts) {
+        out << " " << entry.first << "=" << entry.second;
+    }
+    out << "\n"
+        << "heap allocations: " << heap_allocation_count() << " (" << heap_allocation_bytes() << " bytes)\n"
+        << "poly evaluations: " << poly_evaluations << "\n"
+        << "multiplications: " << multiplications << "\n"
+        << "shared nodes: " << unique_nodes << " unique of " << interned_nodes << " parsed ("
+        << (unique_nodes > 0 ? (double) interned_nodes / unique_nodes : 1.0) << "x)\n"
+        << "frame: " << frame_slots << " slots for " << variables << " variables\n";
+}
@@ -0,0 +1,55 @@
+/*
+ * Run statistics for --stats: per-phase wall time, peak RSS and heap
+ * allocations, plus counters filled in by the parser and interpreter.
+ */
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Global operator new is replaced in stats.cc so allocations can be counted.
+// Nothing is counted until count_heap_allocations() is called.
+void count_heap_allocations();
+long long heap_allocation_count();
+long long heap_allocation_bytes();
+
+struct phase_stat_t {
+    std::string name;
+    long long wall_ns = 0;
+    long long allocations = 0;
+    long peak_rss_kb = 0;
+};
+
+class RunStats {
+  public:
+    // Phases nest; time spent in a nested phase is not charged to its parent.
+    void begin_phase(const std::string& name);
+    void end_phase();
+    void report(std::ostream& out, bool json);
+
+    size_t tokens = 0;
+    std::map<std::string, long long> node_counts;
+    long long poly_evaluations = 0;
+    long long multiplications = 0;
+    long long interned_nodes = 0;    // polynomial nodes built by the parser
+    long long unique_nodes = 0;      // after hash-consing
+    long long variables = 0;
+    long long frame_slots = 0;
+
+  private:
+    struct open_phase_t {
+        size_t index;
+        long long resumed_ns;
+        long long resumed_allocations;
+    };
+    std::vector<phase_stat_t> phases;
+    std::vector<open_phase_t> open;
+
+    size_t phase_index(const std::string& name);
+    void charge(open_phase_t& phase);
+};
+
+#endif  //__STATS_H__
@@ -0,0 +1,359 @@
+/*
+ * Tests of the Parser API that a program and its .expected output cannot
+ * cover. Each test gets one result two ways, e.g. by reparsing an edited
+ * POLY section and by parsing the edited program from scratch, and checks
+ * that they agree:
+ *
+ *   api_tests [--verbose]
+ */
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../parser.h"
+
+using namespace std;
+
+namespace {
+
+struct api_test_t {
+    const char* name;
+    void (*run)();
+};
+
+int failures = 0;
+string current_test;
+
+void check_equal(const string& what, const string& expected, const string& got) {
+    if (expected == got) return;
+    failures++;
+    cout << current_test << ": " << what << "\n"
+         << "--------------------------------------------------------\n"
+         << "expected:\n" << expected << (expected.empty() || expected.back() == '\n' ? "" : "\n")
+         << "got:\n" << got << (got.empty() || got.back() == '\n' ? "" : "\n")
+         << "========================================================\n";
+}
+
+// Output of the semantic checks and tasks of a parsed program, up to the
+// first parser_exit_t
+string run_parsed(Parser& parser) {
+    ostringstream out;
+    parser.out = &out;
+    try {
+        parser.report_semantic_errors();
+        parser.run_tasks();
+    } catch (const parser_exit_t&) {
+    }
+    return out.str();
+}
+
+// What the command-line program prints for source
+string run_fresh(const string& source) {
+    istringstream in(source);
+    ostringstream out;
+    Parser parser(in);
+    parser.out = &out;
+    try {
+        parser.parse_program();
+        parser.run_tasks();
+    } catch (const parser_exit_t&) {
+    }
+    return out.str();
+}
+
+// ====== Incremental reparse ======
+const string REPARSE_PROGRAM =
+    "TASKS\n"
+    "1 2 3 4 5\n"
+    "POLY\n"
+    "F(x) = x^2 + 1;\n"
+    "G(x, y) = x y - (x + 1)^3;\n"
+    "H = 2 x + 3;\n"
+    "EXECUTE\n"
+    "INPUT a;\n"
+    "INPUT b;\n"
+    "c = F(a);\n"
+    "d = G(c, b);\n"
+    "OUTPUT d;\n"
+    "e = H(c);\n"
+    "c = F(e);\n"
+    "OUTPUT c;\n"
+    "INPUTS\n"
+    "3 4\n";
+
+// Applied one after another to the same parser
+const char* const REPARSE_EDITS[] = {
+    // a changed body
+    "\nF(x) = x^3 - 2;\nG(x, y) = x y - (x + 1)^3;\nH = 2 x + 3;\n",
+    // a new declaration over several lines moves the EXECUTE section down
+    "\nK(x, y) =\n    x + y;\nF(x) = x^3 - 2;\nG(x, y) = x y - (x + 1)^3;\nH = 2 x + 3;\n",
+    // a called polynomial removed: Semantic Error Code 3
+    "\nK(x, y) =\n    x + y;\nF(x) = x^3 - 2;\nH = 2 x + 3;\n",
+    // a duplicate: Semantic Error Code 1
+    "\nF(x) = x;\nG(x, y) = x y;\nF(x) = x + 1;\nH = 2 x + 3;\n",
+    // an arity change: Semantic Error Code 4
+    "\nF(x) = x;\nG(x) = x;\nH = 2 x + 3;\n",
+    // a variable that is not a parameter: Semantic Error Code 2
+    "\nF(x) = x + q;\nG(x, y) = x y;\nH = 2 x + 3;\n",
+    // lines removed, and back to the original declarations
+    " F(x) = x^2 + 1; G(x, y) = x y - (x + 1)^3; H = 2 x + 3;\n",
+    "\nF(x) = x^2 + 1;\nG(x, y) = x y - (x + 1)^3;\nH = 2 x + 3;\n",
+};
+
+void test_reparse_matches_fresh_parse() {
+    size_t begin, end;
+    int first_line;
+    if (!Parser::find_poly_section(REPARSE_PROGRAM, begin, end, first_line)) {
+        check_equal("POLY section", "found", "not found");
+        return;
+    }
+    istringstream in(REPARSE_PROGRAM);
+    Parser incremental(in);
+    incremental.parse_program();
+    for (const char* section : REPARSE_EDITS) {
+        string edited = REPARSE_PROGRAM.substr(0, begin) + section + REPARSE_PROGRAM.substr(end);
+        incremental.reparse_poly_section(section, first_line);
+        check_equal("reparse of\n" + edited, run_fresh(edited), run_parsed(incremental));
+    }
+}
+
+// ====== Batch evaluation modulo P ======
+const int BATCH_DEGREE = 1024;
+const size_t BATCH_POINTS = 1100;    // enough for the subproduct tree
+
+// c_e of F = sum c_e x^e, as written in the program below
+long long batch_coefficient(int e) {
+    if (e == BATCH_DEGREE) return 1;
+    long long c = e * 7919LL % 100003 + 1;
+    return (e % 3 == 0) ? -c : c;
+}
+
+string batch_program() {
+    string program = "TASKS\n5\nPOLY\nF = x^" + to_string(BATCH_DEGREE);
+    for (int e = BATCH_DEGREE - 1; e >= 0; e--) {
+        long long c = batch_coefficient(e);
+        program += (c < 0 ? " - " : " + ") + to_string(c < 0 ? -c : c);
+        if (e > 0) program += " x^" + to_string(e);
+    }
+    return program + ";\nEXECUTE\nINPUT x;\nINPUTS\n1\n";
+}
+
+uint64_t reduce_signed(long long a, uint64_t p) {
+    uint64_t r = (a < 0) ? p - (0ull - (uint64_t) a) % p : (uint64_t) a % p;
+    return r == p ? 0 : r;
+}
+
+// Horner's rule in 128-bit integers, without Montgomery form
+uint64_t horner(long long point, uint64_t p) {
+    unsigned __int128 x = reduce_signed(point, p);
+    unsigned __int128 value = 0;
+    for (int e = BATCH_DEGREE; e >= 0; e--) {
+        value = (value * x + reduce_signed(batch_coefficient(e), p)) % p;
+    }
+    return (uint64_t) value;
+}
+
+void test_multipoint_matches_per_point() {
+    // Montgomery form needs an odd modulus, so 2 is refused and 3 is the
+    // smallest one accepted
+    check_equal("--mod 2 accepted", "0", to_string(is_mod_modulus(2)));
+    check_equal("--mod 3 accepted", "1", to_string(is_mod_modulus(3)));
+
+    vector<long long> points = {0, 1, -1, 0};
+    for (size_t i = points.size(); i < BATCH_POINTS; i++) {
+        long long point = (long long) (i * 2654435761u % 2000000011) - 1000000005;
+        points.push_back(i % 97 == 0 ? 0 : point);
+    }
+    points.push_back(INT64_MAX);
+    points.push_back(INT64_MIN);
+
+    istringstream in(batch_program());
+    Parser parser(in);
+    parser.parse_program();
+    parser.arith_mode = ARITH_MOD;
+    const uint64_t moduli[] = {3, 1000000007, 9223372036854775783ull, 18446744073709551557ull};
+    for (uint64_t p : moduli) {
+        check_equal(to_string(p) + " accepted", "1", to_string(is_mod_modulus(p)));
+        parser.mont = Montgomery(p);
+        for (int multipoint = 0; multipoint < 2; multipoint++) {
+            parser.use_multipoint = multipoint != 0;
+            vector<uint64_t> batch = parser.evaluate_poly_mod_batch("F", {points});
+            ostringstream expected, got;
+            for (size_t i = 0; i < points.size(); i++) {
+                expected << "F(" << points[i] << ") = " << horner(points[i], p) << "\n";
+                got << "F(" << points[i] << ") = " << (i < batch.size() ? batch[i] : 0) << "\n";
+            }
+            check_equal(string(multipoint ? "multipoint" : "lane by lane") + " modulo " + to_string(p),
+                        expected.str(), got.str());
+        }
+    }
+}
+
+// ====== Incremental re-execution ======
+// G and K read z, which is not a parameter, from memory
+const string SWEEP_PROGRAM =
+    "TASKS\n"
+    "2\n"
+    "POLY\n"
+    "F(x, y) = x^2 + y;\n"
+    "G(x) = 3 x - z;\n"
+    "H(a, b, c) = a b - c^2;\n"
+    "K = z^2 + 1;\n"
+    "EXECUTE\n"
+    "INPUT u;\n"
+    "INPUT v;\n"
+    "INPUT w;\n"
+    "z = F(u, 1);\n"
+    "p = G(v);\n"
+    "OUTPUT p;\n"
+    "q = H(p, w, z);\n"
+    "u = F(q, u);\n"
+    "OUTPUT u;\n"
+    "r = G(3);\n"
+    "OUTPUT r;\n"
+    "z = F(w, w);\n"
+    "s = K(7);\n"
+    "OUTPUT s;\n"
+    "OUTPUT z;\n"
+    "OUTPUT v;\n";
+
+// n is never assigned, so the call binds it at run time and the whole
+// program runs again on every call
+const string SWEEP_UNBOUND_PROGRAM =
+    "TASKS\n"
+    "2\n"
+    "POLY\n"
+    "F(x, y) = x^2 + y;\n"
+    "EXECUTE\n"
+    "INPUT u;\n"
+    "INPUT v;\n"
+    "a = F(u, v);\n"
+    "OUTPUT a;\n"
+    "b = F(n, a);\n"
+    "OUTPUT b;\n";
+
+string with_inputs(const string& program, const vector<int>& inputs) {
+    string source = program + "INPUTS\n";
+    for (int value : inputs) {
+        source += to_string(value) + " ";
+    }
+    return source + "\n";
+}
+
+// A full execute_program() on a new parser. INPUTS values also select
+// tasks, so run_tasks() could do more than execute.
+string execute_fresh(const string& source, bool use_jit) {
+    istringstream in(source);
+    ostringstream out;
+    Parser parser(in);
+    parser.out = &out;
+    parser.use_jit = use_jit;
+    try {
+        parser.parse_program();
+        parser.execute_program();
+    } catch (const parser_exit_t&) {
+    }
+    return out.str();
+}
+
+void check_sweep(const string& program, vector<int> inputs, bool use_jit) {
+    istringstream in(with_inputs(program, inputs));
+    Parser incremental(in);
+    incremental.parse_program();
+    incremental.use_jit = use_jit;
+    // (input, value) pairs set before each run; a round may repeat a value
+    // or change nothing
+    const vector<vector<pair<size_t, int>>> rounds = {
+        {}, {{0, 5}}, {{1, 4}}, {{1, 4}}, {}, {{0, 5}, {2, 9}}, {{2, 3}, {2, 0}},
+        {{0, 1}, {1, 2}, {2, 3}}, {{1, 100000}}, {{0, 2147483647}},
+    };
+    for (size_t round = 0; round < rounds.size(); round++) {
+        for (const pair<size_t, int>& change : rounds[round]) {
+            if (change.first >= inputs.size()) continue;
+            incremental.set_input(change.first, change.second);
+            inputs[change.first] = change.second;
+        }
+        ostringstream out;
+        incremental.out = &out;
+        try {
+            incremental.execute_incremental();
+        } catch (const parser_exit_t&) {
+        }
+        string source = with_inputs(program, inputs);
+        check_equal(string(use_jit ? "--jit, " : "") + "round " + to_string(round) + " of\n" + source,
+                    execute_fresh(source, use_jit), out.str());
+    }
+}
+
+void test_incremental_matches_full_run() {
+    for (int use_jit = 0; use_jit < 2; use_jit++) {
+        check_sweep(SWEEP_PROGRAM, {1, 2, 3}, use_jit != 0);
+        check_sweep(SWEEP_UNBOUND_PROGRAM, {4, 6}, use_jit != 0);
+    }
+}
+
+// ====== Semantic checks without the parse ======
+// TASKS leaves out 1 so that the errors do not stop the parse
+const char* const SEMANTIC_PROGRAMS[] = {
+    // Semantic Error Code 1, which hides Code 2
+    "TASKS\n2\nPOLY\nF(x) = x + y;\nG = x;\nF(x, z) =\n  z x;\nEXECUTE\nINPUT a;\nb = F(a);\nOUTPUT b;\nINPUTS\n1\n",
+    // Semantic Error Code 2
+    "TASKS\n2\nPOLY\nF(x) = x + y;\nG(a, b) = a b c\n  + d;\nEXECUTE\nINPUT a;\nb = F(a);\nOUTPUT b;\nINPUTS\n1\n",
+    // Semantic Error Code 3, which hides Code 4
+    "TASKS\n2\nPOLY\nF(x, y) = x y;\nG = x^2;\nEXECUTE\nINPUT a;\nb = F(a);\nc = H(a, G(\nb, a));\n"
+    "OUTPUT c;\nINPUTS\n1\n",
+    // Semantic Error Code 4, with a nested call on a later line
+    "TASKS\n2\nPOLY\nF(x, y) = x y;\nG = x^2;\nEXECUTE\nINPUT a;\nb = F(a);\nc = F(a, G(\nb, a));\n"
+    "OUTPUT c;\nINPUTS\n1\n",
+    // Warning Codes 1 and 2
+    "TASKS\n3 4\nPOLY\nF(x, y) = x + y;\nEXECUTE\nINPUT a;\nb = F(a, c);\nb = F(b, a);\nd = F(e, b);\n"
+    "c = F(a, a);\nOUTPUT b;\nINPUTS\n1\n",
+};
+
+// Reports of a parsed program once task 1 is requested
+string report_with_task_1(const string& source, bool recheck) {
+    istringstream in(source);
+    Parser parser(in);
+    parser.parse_program();
+    if (recheck) parser.recheck_semantics();
+    parser.task_numbers.insert(1);
+    return run_parsed(parser);
+}
+
+void test_recheck_matches_parse() {
+    for (const char* program : SEMANTIC_PROGRAMS) {
+        check_equal(string("recheck of\n") + program, report_with_task_1(program, false),
+                    report_with_task_1(program, true));
+    }
+    check_equal("recheck of\n" + REPARSE_PROGRAM, report_with_task_1(REPARSE_PROGRAM, false),
+                report_with_task_1(REPARSE_PROGRAM, true));
+}
+
+const api_test_t TESTS[] = {
+    {"reparse_matches_fresh_parse", test_reparse_matches_fresh_parse},
+    {"multipoint_matches_per_point", test_multipoint_matches_per_point},
+    {"incremental_matches_full_run", test_incremental_matches_full_run},
+    {"recheck_matches_parse", test_recheck_matches_parse},
+};
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    bool verbose = argc > 1 && string(argv[1]) == "--verbose";
+    int passed = 0;
+    for (const api_test_t& test : TESTS) {
+        int failures_before = failures;
+        current_test = test.name;
+        test.run();
+        if (failures == failures_before) {
+            passed++;
+            if (verbose) cout << test.name << ": OK\n";
+        }
+    }
+    int total = (int) (sizeof(TESTS) / sizeof(TESTS[0]));
+    cout << "\nPassed " << passed << " API tests out of " << total << "\n";
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#!/bin/bash
+#
+# Builds the test runner and runs it over provided_tests, then builds and
+# runs the API tests (api_tests.cc). Arguments are passed to the runner,
+# e.g. --jobs 4 --slowest 10 or a different test directory.
+#
+
+cd "$(dirname "$0")"
+
+# Every source next to parser.cc is part of the build; PARSER_NO_MAIN drops
+# the command-line main().
+g++ -std=c++17 -O2 -pthread -DPARSER_NO_MAIN -o test_runner test_runner.cc ../*.cc || exit 1
+g++ -std=c++17 -O2 -pthread -DPARSER_NO_MAIN -o api_tests api_tests.cc ../*.cc || exit 1
+
+if [ $# -eq 0 ]; then
+    set -- ../../provided_tests
+fi
+./test_runner "$@"
+status=$?
+./api_tests || status=1
+exit $status
@@ -0,0 +1,222 @@
+/*
+ * In-process replacement for test1.sh. Every *.txt test under the test
+ * directory is parsed and run on a pool of threads, and its output is
+ * compared in memory with the matching .expected file:
+ *
+ *   test_runner [--jobs N] [--slowest N] [--verbose] [test directory]
+ *
+ * A test that throws is reported as one failure and the run goes on.
+ *
+ * Matching follows test1.sh: output is compared like `diff -Bw` (blank lines
+ * and whitespace ignored). Tests in a top-level Syntax_Error folder only
+ * check whether both sides are, or are not, the syntax error message.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "../parser.h"
+
+using namespace std;
+
+namespace {
+
+const string SYNTAX_ERROR = "SYNTAX ERROR !!!!!&%!!";
+
+struct test_case_t {
+    string path;       // relative to the test directory
+    string folder;     // first path component, as in test1.sh
+    string output;
+    string expected;
+    string crash;      // what the program threw, if it threw
+    bool passed = false;
+    double runtime_ms = 0;
+};
+
+void find_tests(const string& root, const string& rel, vector<test_case_t>& tests) {
+    string dir = rel.empty() ? root : root + "/" + rel;
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) return;
+    while (struct dirent* entry = readdir(d)) {
+        string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        string child = rel.empty() ? name : rel + "/" + name;
+        struct stat st;
+        if (stat((root + "/" + child).c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            find_tests(root, child, tests);
+        } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) {
+            test_case_t test;
+            test.path = child;
+            test.folder = child.substr(0, child.find('/'));
+            tests.push_back(test);
+        }
+    }
+    closedir(d);
+}
+
+string read_file(const string& path) {
+    ifstream in(path, ios::binary);
+    stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+// Lines with all whitespace removed, blank lines dropped: what diff -Bw compares
+vector<string> normalize(const string& text) {
+    vector<string> lines;
+    istringstream in(text);
+    string line;
+    while (getline(in, line)) {
+        line.erase(remove_if(line.begin(), line.end(), [](unsigned char c) { return isspace(c); }),
+                   line.end());
+        if (!line.empty()) lines.push_back(line);
+    }
+    return lines;
+}
+
+// bash $(<file) drops trailing newlines
+string strip_trailing_newlines(string text) {
+    while (!text.empty() && text.back() == '\n') text.pop_back();
+    return text;
+}
+
+bool matches(const test_case_t& test) {
+    if (test.folder == "Syntax_Error") {
+        bool expected_error = strip_trailing_newlines(test.expected) == SYNTAX_ERROR;
+        bool output_error = strip_trailing_newlines(test.output) == SYNTAX_ERROR;
+        return expected_error == output_error;
+    }
+    return normalize(test.expected) == normalize(test.output);
+}
+
+// Parses and runs source, as the main program would on stdin. An exception
+// other than parser_exit_t is recorded in crash, so the test fails and the
+// run goes on.
+string run_program(const string& source, string& crash) {
+    istringstream in(source);
+    ostringstream out;
+    Parser parser(in);
+    parser.out = &out;
+    try {
+        parser.parse_program();
+        parser.run_tasks();
+    } catch (const parser_exit_t&) {
+        // the output up to the exit is what gets compared
+    } catch (const std::exception& e) {
+        crash = string("uncaught exception: ") + e.what();
+    }
+    return out.str();
+}
+
+void run_test(const string& root, test_case_t& test) {
+    string source = read_file(root + "/" + test.path);
+    test.expected = read_file(root + "/" + test.path + ".expected");
+
+    auto start = chrono::steady_clock::now();
+    test.output = run_program(source, test.crash);
+    auto end = chrono::steady_clock::now();
+    test.runtime_ms = chrono::duration<double, milli>(end - start).count();
+    test.passed = test.crash.empty() && matches(test);
+}
+
+void usage(const char* prog) {
+    cerr << "usage: " << prog << " [--jobs N] [--slowest N] [--verbose] [test directory]\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    string root = "provided_tests";
+    int jobs = max(1u, thread::hardware_concurrency());
+    int slowest = 5;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--jobs" && i + 1 < argc) {
+            jobs = max(1, atoi(argv[++i]));
+        } else if (arg == "--slowest" && i + 1 < argc) {
+            slowest = max(0, atoi(argv[++i]));
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            root = arg;
+        }
+    }
+
+    vector<test_case_t> tests;
+    find_tests(root, "", tests);
+    if (tests.empty()) {
+        cerr << "Error: no tests found under " << root << endl;
+        return 1;
+    }
+    sort(tests.begin(), tests.end(),
+         [](const test_case_t& a, const test_case_t& b) { return a.path < b.path; });
+
+    auto start = chrono::steady_clock::now();
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for (int j = 0; j < jobs; j++) {
+        workers.emplace_back([&] {
+            for (size_t i = next++; i < tests.size(); i = next++) {
+                run_test(root, tests[i]);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    double total_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    int passed = 0;
+    for (const test_case_t& test : tests) {
+        if (test.passed) {
+            passed++;
+            if (verbose) {
+                cout << test.path << ": OK (" << test.runtime_ms << " ms)\n";
+            }
+            continue;
+        }
+        if (!test.crash.empty()) {
+            cout << test.path << ": Crashed, " << test.crash << " (" << test.runtime_ms << " ms)\n"
+                 << "========================================================\n";
+            continue;
+        }
+        cout << test.path << ": Output does not match expected (" << test.runtime_ms << " ms)\n"
+             << "--------------------------------------------------------\n"
+             << "expected:\n" << test.expected << (test.expected.empty() || test.expected.back() == '\n' ? "" : "\n")
+             << "got:\n" << test.output << (test.output.empty() || test.output.back() == '\n' ? "" : "\n")
+             << "========================================================\n";
+    }
+
+    if (slowest > 0) {
+        vector<const test_case_t*> by_time;
+        for (const test_case_t& test : tests) {
+            by_time.push_back(&test);
+        }
+        sort(by_time.begin(), by_time.end(),
+             [](const test_case_t* a, const test_case_t* b) { return a->runtime_ms > b->runtime_ms; });
+        cout << "\nSlowest tests:\n";
+        for (int i = 0; i < slowest && i < (int) by_time.size(); i++) {
+            cout << "  " << by_time[i]->runtime_ms << " ms  " << by_time[i]->path << "\n";
+        }
+    }
+
+    cout << "\nPassed " << passed << " tests out of " << tests.size()
+         << " (" << total_ms << " ms on " << jobs << " threads)\n";
+    return passed == (int) tests.size() ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/*
+ * Vectorized evaluation of wide term lists.
+ *
+ * Products and sums are unsigned 32-bit and wrap, so the order in which
+ * factors are multiplied and terms are added does not change the result,
+ * and OP_MINUS is folded into the coefficient. The AVX2 and AVX-512
+ * kernels are compiled with target attributes and only called after
+ * __builtin_cpu_supports() has approved them.
+ */
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "parser.h"
+#include "wide_eval.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define WIDE_X86 1
+#else
+#define WIDE_X86 0
+#endif
+
+using namespace std;
+
+namespace {
+
+// A list whose longest term has more factors pads every term to that many
+const size_t WIDE_MAX_FACTORS = 8;
+
+uint32_t wide_sum_scalar(const wide_list_t& wide, const uint32_t* table) {
+    const size_t n = wide.padded_terms;
+    uint32_t sum = 0;
+    for (size_t t = 0; t < n; t++) {
+        uint32_t product = wide.coefficient[t];
+        for (size_t j = 0; j < wide.factors; j++) {
+            product *= table[wide.index[j * n + t]];
+        }
+        sum += product;
+    }
+    return sum;
+}
+
+#if WIDE_X86
+__attribute__((target("avx2")))
+uint32_t wide_sum_avx2(const wide_list_t& wide, const uint32_t* table) {
+    const size_t n = wide.padded_terms;
+    const int* base = reinterpret_cast<const int*>(table);
+    __m256i sum = _mm256_setzero_si256();
+    for (size_t t = 0; t < n; t += 8) {
+        __m256i product = _mm256_load_si256(reinterpret_cast<const __m256i*>(&wide.coefficient[t]));
+        for (size_t j = 0; j < wide.factors; j++) {
+            __m256i index = _mm256_load_si256(reinterpret_cast<const __m256i*>(&wide.index[j * n + t]));
+            product = _mm256_mullo_epi32(product, _mm256_i32gather_epi32(base, index, 4));
+        }
+        sum = _mm256_add_epi32(sum, product);
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+    return (uint32_t) _mm_cvtsi128_si32(half);
+}
+
+__attribute__((target("avx512f")))
+uint32_t wide_sum_avx512(const wide_list_t& wide, const uint32_t* table) {
+    const size_t n = wide.padded_terms;
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i sum = zero;
+    for (size_t t = 0; t < n; t += 16) {
+        __m512i product = _mm512_load_si512(&wide.coefficient[t]);
+        for (size_t j = 0; j < wide.factors; j++) {
+            __m512i index = _mm512_load_si512(&wide.index[j * n + t]);
+            __m512i factor = _mm512_mask_i32gather_epi32(zero, 0xffff, index, table, 4);
+            product = _mm512_mullo_epi32(product, factor);
+        }
+        sum = _mm512_add_epi32(sum, product);
+    }
+    alignas(64) uint32_t lanes[16];
+    _mm512_store_si512(lanes, sum);
+    uint32_t total = 0;
+    for (uint32_t lane : lanes) total += lane;
+    return total;
+}
+#endif
+
+}  // namespace
+
+void build_wide_lists(flat_poly_t& flat) {
+    flat.wide_index.assign(flat.list_end.size(), -1);
+    flat.wide.clear();
+    unsigned int t = 0;
+    for (size_t k = 0; k < flat.list_end.size(); k++) {
+        unsigned int first_term = t;
+        t = flat.list_end[k];
+        size_t terms = t - first_term;
+        if (terms < WIDE_MIN_TERMS) continue;
+
+        size_t factors = 0;
+        for (unsigned int u = first_term; u < t; u++) {
+            unsigned int begin = (u > 0) ? flat.term_end[u - 1] : 0;
+            factors = max(factors, (size_t) (flat.term_end[u] - begin));
+        }
+        if (factors > WIDE_MAX_FACTORS) continue;
+
+        unsigned int first_monomial = (first_term > 0) ? flat.term_end[first_term - 1] : 0;
+        map<tuple<unsigned char, unsigned int, unsigned int>, uint32_t> entries;
+        for (unsigned int m = first_monomial; m < flat.term_end[t - 1]; m++) {
+            if (flat.exponent[m] == 0) continue;
+            entries[make_tuple((unsigned char) flat.operand_kind[m], flat.operand[m], (unsigned int) flat.exponent[m])] = 0;
+        }
+
+        wide_list_t wide;
+        for (auto& entry : entries) {
+            wide.base_kind.push_back(get<0>(entry.first));
+            wide.base_operand.push_back(get<1>(entry.first));
+            wide.base_exponent.push_back(get<2>(entry.first));
+            entry.second = (uint32_t) wide.base_exponent.size();
+        }
+        wide.factors = factors;
+        wide.padded_terms = (terms + WIDE_LANES - 1) / WIDE_LANES * WIDE_LANES;
+        wide.coefficient.assign(wide.padded_terms, 0);
+        wide.index.assign(factors * wide.padded_terms, 0);
+        for (unsigned int u = first_term; u < t; u++) {
+            size_t lane = u - first_term;
+            uint32_t coefficient = (uint32_t) flat.coefficient[u];
+            wide.coefficient[lane] = flat.negate[u] ? 0u - coefficient : coefficient;
+            unsigned int begin = (u > 0) ? flat.term_end[u - 1] : 0;
+            for (unsigned int m = begin; m < flat.term_end[u]; m++) {
+                if (flat.exponent[m] == 0) continue;
+                auto key = make_tuple((unsigned char) flat.operand_kind[m], flat.operand[m], (unsigned int) flat.exponent[m]);
+                wide.index[(m - begin) * wide.padded_terms + lane] = entries[key];
+            }
+        }
+        flat.wide_index[k] = (int) flat.wide.size();
+        flat.wide.push_back(std::move(wide));
+    }
+}
+
+WideKernel wide_native_kernel() {
+#if WIDE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return WIDE_AVX512;
+    if (__builtin_cpu_supports("avx2")) return WIDE_AVX2;
+#endif
+    return WIDE_SCALAR;
+}
+
+uint32_t wide_sum(const wide_list_t& wide, const uint32_t* table, WideKernel kernel) {
+    static const WideKernel native = wide_native_kernel();
+    if (kernel == WIDE_AUTO || kernel > native) kernel = native;
+#if WIDE_X86
+    if (kernel == WIDE_AVX512) return wide_sum_avx512(wide, table);
+    if (kernel == WIDE_AVX2) return wide_sum_avx2(wide, table);
+#endif
+    return wide_sum_scalar(wide, table);
+}
@@ -0,0 +1,65 @@
+/*
+ * Vectorized evaluation of wide term lists.
+ *
+ * A term list with many terms is laid out for SIMD: every distinct
+ * (base, exponent) pair of the list gets an entry in a power table that
+ * the caller fills once per evaluation, and each term becomes a signed
+ * coefficient plus one table index per factor. The kernel then gathers
+ * factors and multiplies 8 (AVX2) or 16 (AVX-512) terms at a time. The
+ * instruction set is picked at run time; the scalar loop is the fallback.
+ */
+#ifndef __WIDE_EVAL_H__
+#define __WIDE_EVAL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+struct flat_poly_t;
+
+// Lists with fewer terms are summed term by term
+const size_t WIDE_MIN_TERMS = 32;
+// Terms are padded to a multiple of the widest vector
+const size_t WIDE_LANES = 16;
+
+enum WideKernel { WIDE_AUTO, WIDE_OFF, WIDE_SCALAR, WIDE_AVX2, WIDE_AVX512 };
+
+template <typename T>
+struct aligned_allocator_t {
+    typedef T value_type;
+    aligned_allocator_t() = default;
+    template <typename U> aligned_allocator_t(const aligned_allocator_t<U>&) {}
+    T* allocate(size_t n) {
+        void* p = nullptr;
+        if (posix_memalign(&p, 64, n * sizeof(T)) != 0) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t) { free(p); }
+    template <typename U> bool operator==(const aligned_allocator_t<U>&) const { return true; }
+    template <typename U> bool operator!=(const aligned_allocator_t<U>&) const { return false; }
+};
+
+typedef std::vector<uint32_t, aligned_allocator_t<uint32_t>> aligned_u32_t;
+
+struct wide_list_t {
+    // power table entry i + 1 is base^exponent; entry 0 is 1. Entries are
+    // sorted by base, so a power can be built from the one before it.
+    std::vector<unsigned char> base_kind;      // FlatOperand
+    std::vector<unsigned int> base_operand;
+    std::vector<unsigned int> base_exponent;
+    size_t factors = 0;                        // table indices per term
+    size_t padded_terms = 0;
+    aligned_u32_t coefficient;                 // negated for OP_MINUS, 0 in padding
+    aligned_u32_t index;                       // factor j of term t at j * padded_terms + t
+};
+
+// Builds flat.wide for every list that is worth it
+void build_wide_lists(flat_poly_t& flat);
+// Sum over terms of coefficient times the product of table[index]
+uint32_t wide_sum(const wide_list_t& wide, const uint32_t* table, WideKernel kernel);
+// Instruction set WIDE_AUTO resolves to on this machine
+WideKernel wide_native_kernel();
+
+#endif  //__WIDE_EVAL_H__